@@ -0,0 +1,310 @@
+// Cost of the building blocks of a frame in ns/op.
+//
+//   make bench && ./bin/bench_micro [--warmup n] [--repetitions n] [--filter name] [--output path]
+//
+// Each kernel runs over a few thousand random inputs per repetition, after
+// untimed warmup repetitions, and the ns/op of every repetition is reported
+// as mean, standard deviation, min, p50 and max. --output also writes the
+// table as CSV, or JSON for a .json path. Inputs come from a fixed seed and
+// the texture is generated, so no window or asset is needed.
+#include "../lib/mat4.h"
+#include "../lib/vec4.h"
+#include "../lib/vec3.h"
+#include "../lib/edgetable.h"
+#include "../lib/illumination.h"
+#include "../lib/texture.h"
+#include "../lib/profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int COUNT = 4096;      // inputs per repetition
+static const int SCANLINES = 600;   // edge table height
+
+// Forces the compiler to assume memory at p is read, so results stored
+// there are computed even though nothing uses them
+static inline void Escape(const void *p) {
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+static float Random(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static vec3 RandomUnit(void) {
+    vec3 n(Random(-1, 1), Random(-1, 1), Random(-1, 1));
+    return n.normalize();
+}
+
+// ns/op of every timed repetition of one kernel
+class MicroResult {
+public:
+    std::string name;
+    int ops;                        // per repetition
+    ProfileSummary ns;
+    double stddev;
+    double min;
+
+public:
+    MicroResult(const std::string &name, int ops, const std::vector< double > &samples) : name(name), ops(ops), ns(samples) {
+        double sum = 0.0;
+        for (double s : samples) {
+            sum += (s - ns.mean) * (s - ns.mean);
+        }
+        stddev = samples.size() > 1 ? sqrt(sum / (samples.size() - 1)) : 0.0;
+        min = *std::min_element(samples.begin(), samples.end());
+    }
+};
+
+class MicroBench {
+public:
+    int warmup;
+    int repetitions;
+    const char *filter;             // run only kernels whose name contains this
+    std::vector< MicroResult > results;
+
+public:
+    MicroBench() : warmup(3), repetitions(30), filter(NULL) {
+    }
+
+    // Time kernel, which performs ops operations, after setup, which is not timed
+    void Run(const char *name, int ops, std::function< void() > setup, std::function< void() > kernel) {
+        if (filter != NULL && strstr(name, filter) == NULL) {
+            return;
+        }
+        std::vector< double > samples;
+        for (int k = 0; k < warmup + repetitions; k++) {
+            setup();
+            Clock::time_point start = Clock::now();
+            kernel();
+            double ns = std::chrono::duration< double, std::nano >(Clock::now() - start).count();
+            if (k >= warmup) {
+                samples.push_back(ns / ops);
+            }
+        }
+        results.push_back(MicroResult(name, ops, samples));
+        const MicroResult &r = results.back();
+        printf("%-30s %8d %10.2f %8.2f %10.2f %10.2f %10.2f\n", name, ops, r.ns.mean, r.stddev, r.min, r.ns.p50, r.ns.max);
+    }
+
+    void Run(const char *name, int ops, std::function< void() > kernel) {
+        Run(name, ops, [](){}, kernel);
+    }
+
+    bool Write(const char *path) const {
+        FILE *file = fopen(path, "w");
+        if (file == NULL) {
+            printf("Unable to open %s for writing\n", path);
+            return false;
+        }
+        size_t length = strlen(path);
+        bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+        if (json) {
+            fprintf(file, "{\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"kernels\": [\n", warmup, repetitions);
+        }
+        else {
+            fprintf(file, "kernel,ops,repetitions,mean_ns,stddev_ns,min_ns,p50_ns,max_ns\n");
+        }
+        for (size_t k = 0; k < results.size(); k++) {
+            const MicroResult &r = results[k];
+            if (json) {
+                fprintf(file, "    {\"kernel\": \"%s\", \"ops\": %d, \"mean_ns\": %.4f, \"stddev_ns\": %.4f, \"min_ns\": %.4f, \"p50_ns\": %.4f, \"max_ns\": %.4f}%s\n",
+                    r.name.c_str(), r.ops, r.ns.mean, r.stddev, r.min, r.ns.p50, r.ns.max, k + 1 < results.size() ? "," : "");
+            }
+            else {
+                fprintf(file, "%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n", r.name.c_str(), r.ops, repetitions,
+                    r.ns.mean, r.stddev, r.min, r.ns.p50, r.ns.max);
+            }
+        }
+        if (json) {
+            fprintf(file, "  ]\n}\n");
+        }
+        bool ok = ferror(file) == 0;
+        if (fclose(file) != 0 || !ok) {
+            printf("Error writing %s\n", path);
+            return false;
+        }
+        return true;
+    }
+};
+
+// Step COUNT scanlines of two active edges, the usual span of a convex polygon
+template <int ATTRIBS>
+static void RunUpdateEdges(MicroBench &bench, const char *name) {
+    std::vector< Edge > edges;
+    ActiveEdgeTable aet;
+    bench.Run(name, COUNT,
+        [&]() {
+            edges.clear();
+            edges.push_back(Edge(1 << 30, 10.0f, 0.37f, 0.5f, 1e-5f, vec3(0, 0, -1), vec3(1e-4f, 0, 0), vec3(), vec3(1e-3f, 0, 0)));
+            edges.push_back(Edge(1 << 30, 500.0f, -0.21f, 0.6f, -1e-5f, vec3(0, 1, 0), vec3(0, -1e-4f, 0), vec3(), vec3(0, 1e-3f, 0)));
+            aet.Clear();
+            aet.InsertEdge(10, &edges[0]);
+            aet.InsertEdge(500, &edges[1]);
+        },
+        [&]() {
+            for (int y = 0; y < COUNT; y++) {
+                aet.UpdateEdges< ATTRIBS >(y);
+            }
+            Escape(edges.data());
+        });
+}
+
+int main(int argc, char* args[]) {
+    MicroBench bench;
+    const char *output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--warmup") == 0 && i + 1 < argc) {
+            bench.warmup = std::max(atoi(args[++i]), 0);
+        }
+        else if (strcmp(args[i], "--repetitions") == 0 && i + 1 < argc) {
+            bench.repetitions = std::max(atoi(args[++i]), 1);
+        }
+        else if (strcmp(args[i], "--filter") == 0 && i + 1 < argc) {
+            bench.filter = args[++i];
+        }
+        else if (strcmp(args[i], "--output") == 0 && i + 1 < argc) {
+            output = args[++i];
+        }
+        else {
+            printf("Usage: %s [--warmup n] [--repetitions n] [--filter name] [--output path]\n", args[0]);
+            return 1;
+        }
+    }
+
+    srand(1);
+    std::vector< mat4 > mats_a(COUNT, mat4(1)), mats_b(COUNT, mat4(1)), mats_out(COUNT, mat4(1));
+    for (int i = 0; i < COUNT; i++) {
+        for (int e = 0; e < 16; e++) {
+            mats_a[i].mat[e] = Random(-2, 2);
+            mats_b[i].mat[e] = Random(-2, 2);
+        }
+    }
+    std::vector< vec4 > points(COUNT), points_out(COUNT);
+    std::vector< vec3 > vecs(COUNT), vecs_out(COUNT), normals(COUNT);
+    for (int i = 0; i < COUNT; i++) {
+        points[i] = vec4(Random(-10, 10), Random(-10, 10), Random(-10, 10), 1);
+        vecs[i] = vec3(Random(-10, 10), Random(-10, 10), Random(-10, 10));
+        normals[i] = RandomUnit();
+    }
+
+    printf("%d warmup and %d timed repetitions, ns/op\n", bench.warmup, bench.repetitions);
+    printf("%-30s %8s %10s %8s %10s %10s %10s\n", "kernel", "ops", "mean", "stddev", "min", "p50", "max");
+
+    bench.Run("mat4*mat4", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            mats_out[i] = mats_a[i] * mats_b[i];
+        }
+        Escape(mats_out.data());
+    });
+
+    const mat4 &m = mats_a[0];
+    bench.Run("mat4*vec4", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            points_out[i] = m * points[i];
+        }
+        Escape(points_out.data());
+    });
+
+    bench.Run("vec3.normalize", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            vecs_out[i] = vecs[i];
+            vecs_out[i].normalize();
+        }
+        Escape(vecs_out.data());
+    });
+
+    // Edges bucketed over a screen, about 7 per scanline kept sorted by x_min
+    EdgeTable et(SCANLINES);
+    std::vector< int > scanlines(COUNT);
+    std::vector< Edge > edges;
+    for (int i = 0; i < COUNT; i++) {
+        scanlines[i] = rand() % SCANLINES;
+        int y_max = scanlines[i] + 1 + rand() % 50;
+        edges.push_back(Edge(y_max, Random(0, 800), Random(-2, 2), Random(0, 1), Random(-0.01f, 0.01f),
+            normals[i], RandomUnit() * 0.01f, vecs[i], vec3(0.01f, 0, 0)));
+    }
+    bench.Run("EdgeTable::InsertEdge", COUNT,
+        [&]() {
+            et.Clear();
+        },
+        [&]() {
+            for (int i = 0; i < COUNT; i++) {
+                et.InsertEdge(scanlines[i], edges[i]);
+            }
+            Escape(et.edges.data());
+        });
+    bench.Run("EdgeTable::RemoveEdge", COUNT,
+        [&]() {
+            et.Clear();
+            for (int i = 0; i < COUNT; i++) {
+                et.InsertEdge(scanlines[i], edges[i]);
+            }
+        },
+        [&]() {
+            Edge *last = NULL;
+            for (int y = 0; y < SCANLINES; y++) {
+                while (Edge *e = et.RemoveEdge(y)) {
+                    last = e;
+                }
+            }
+            Escape(last);
+        });
+
+    RunUpdateEdges< 0 >(bench, "AET::UpdateEdges<0>");
+    RunUpdateEdges< 3 >(bench, "AET::UpdateEdges<3>");
+    RunUpdateEdges< 6 >(bench, "AET::UpdateEdges<6>");
+
+    Material material(vec3(1, 1, 1), 0.3, 0.3, 0.4, 30);
+    Light light(vec3(-30, -30, -10), vec3(1, 1, 1));
+    vec3 view(0, 0, -1);
+    vec3 light_direction = vec3(-30, -30, -10).normalize();
+    bench.Run("Material::PhongIllumination", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            vecs_out[i] = material.PhongIllumination(material.color, view, normals[i], light_direction, light);
+        }
+        Escape(vecs_out.data());
+    });
+
+    bench.Run("Material::CartoonIllumination", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            vecs_out[i] = material.CartoonIllumination(normals[i], light_direction);
+        }
+        Escape(vecs_out.data());
+    });
+
+    // A generated 2048x1024 equirectangular image with mip levels, sampled
+    // in random directions at the pixel footprints of a near and far model
+    const int width = 2048, height = 1024;
+    std::vector< Uint32 > texels((size_t)width * height);
+    for (Uint32 &t : texels) {
+        t = (Uint32)rand() | 0xFF000000;
+    }
+    material.texture.Create(width, height, texels.data(), true);
+    std::vector< float > angles(COUNT);
+    for (float &a : angles) {
+        a = Random(0.001f, 0.02f);
+    }
+    bench.Run("Material::GetTexture", COUNT, [&]() {
+        for (int i = 0; i < COUNT; i++) {
+            vecs_out[i] = material.GetTexture(normals[i], angles[i]);
+        }
+        Escape(vecs_out.data());
+    });
+
+    if (output != NULL) {
+        if (!bench.Write(output)) {
+            return 1;
+        }
+        printf("Wrote %s\n", output);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Parse throughput of the .d reader in MB/s.
+//
+//   make bench && ./bin/bench_parse [--iterations n] [--threads n] [model.d ...]
+//
+// Each file is read into memory once. The fscanf row is the per-number
+// fscanf loop LoadModel used before, timed from the open file.
+#include "../lib/dfile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration< double >(Clock::now() - start).count();
+}
+
+// The sequential fscanf parser, kept as the baseline
+static bool ScanDFile(const char* path, std::vector< vec3 > &verts, std::vector< int > &face_offsets, std::vector< int > &face_indices) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return false;
+    }
+    unsigned int numVerts = 0;
+    unsigned int numFaces = 0;
+    fscanf(fp, " data%d%d", &numVerts, &numFaces);
+    verts.resize(numVerts);
+    for (unsigned int i = 0; i < numVerts; i++) {
+        fscanf(fp, "%f%f%f", &verts[i].x, &verts[i].y, &verts[i].z);
+    }
+    face_offsets.assign(1, 0);
+    face_indices.clear();
+    for (unsigned int i = 0; i < numFaces; i++) {
+        int numSides = 0;
+        fscanf(fp, "%i", &numSides);
+        for (int k = 0; k < numSides; k++) {
+            int index = 0;
+            fscanf(fp, "%i", &index);
+            face_indices.push_back(index - 1);
+        }
+        face_offsets.push_back(face_indices.size());
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool ReadFile(const char* path, std::vector< char > &text) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    text.resize(std::max(ftell(fp), 0L));
+    fseek(fp, 0, SEEK_SET);
+    bool ok = fread(text.data(), 1, text.size(), fp) == text.size();
+    fclose(fp);
+    return ok;
+}
+
+int main(int argc, char* args[]) {
+    int iterations = 20;
+    int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    std::vector< const char* > paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(atoi(args[++i]), 1);
+        }
+        else if (strcmp(args[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(atoi(args[++i]), 1);
+        }
+        else {
+            paths.push_back(args[i]);
+        }
+    }
+    if (paths.empty()) {
+        paths = {"assets/dfiles/atc.d", "assets/dfiles/bunny.d", "assets/dfiles/cow.d"};
+    }
+
+    printf("%-24s %8s  %-12s %9s %9s  %s\n", "model", "KB", "parser", "best ms", "MB/s", "result");
+    for (const char* path : paths) {
+        std::vector< char > text;
+        if (!ReadFile(path, text)) {
+            printf("Error reading %s\n", path);
+            return 1;
+        }
+        double mb = text.size() / (1024.0 * 1024.0);
+
+        std::vector< vec3 > ref_verts;
+        std::vector< int > ref_offsets, ref_indices;
+        double best = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            Clock::time_point start = Clock::now();
+            ScanDFile(path, ref_verts, ref_offsets, ref_indices);
+            best = std::min(best, Seconds(start));
+        }
+        printf("%-24s %8zu  %-12s %9.3f %9.1f\n", path, text.size() / 1024, "fscanf", 1000 * best, mb / best);
+
+        // Every thread count up to threads, plus 1 for the single chunk path
+        std::vector< int > counts = {1};
+        for (int t = 2; t <= threads; t *= 2) {
+            counts.push_back(t);
+        }
+        if (threads > 1 && counts.back() != threads) {
+            counts.push_back(threads);
+        }
+        for (int t : counts) {
+            std::vector< vec3 > verts;
+            std::vector< int > offsets, indices;
+            bool ok = true;
+            best = 1e30;
+            for (int k = 0; k < iterations; k++) {
+                Clock::time_point start = Clock::now();
+                ok = ParseDText(path, text.data(), text.size(), verts, offsets, indices, t) && ok;
+                best = std::min(best, Seconds(start));
+            }
+            bool same = ok && offsets == ref_offsets && indices == ref_indices && verts.size() == ref_verts.size() &&
+                memcmp(verts.data(), ref_verts.data(), verts.size() * sizeof(vec3)) == 0;
+            std::string name = "from_chars/" + std::to_string(t);
+            printf("%-24s %8s  %-12s %9.3f %9.1f  %s\n", "", "", name.c_str(), 1000 * best, mb / best,
+                same ? "matches fscanf" : "DIFFERS");
+        }
+    }
+    return 0;
+}
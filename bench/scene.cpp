@@ -0,0 +1,134 @@
+// Scene frustum queries against testing every instance, as scenes grow.
+//
+//   make bench && ./bin/bench_scene [--iterations n] [--moved percent]
+//
+// Scatters unit instances at a fixed density over a floor that grows with
+// the instance count, so about the same number are in view at every size.
+// Times building the hierarchy, a frustum query, testing every instance's
+// box and refitting after --moved percent of the instances (default 1)
+// were translated, and checks the query against testing every box.
+#include "../lib/scene.h"
+#include "../lib/camera.h"
+#include "../lib/mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration< double >(Clock::now() - start).count();
+}
+
+static float Random(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+int main(int argc, char* args[]) {
+    int iterations = 10;
+    double moved_percent = 1.0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(atoi(args[++i]), 1);
+        }
+        else if (strcmp(args[i], "--moved") == 0 && i + 1 < argc) {
+            moved_percent = std::min(std::max(atof(args[++i]), 0.0), 100.0);
+        }
+        else {
+            printf("Usage: %s [--iterations n] [--moved percent]\n", args[0]);
+            return 1;
+        }
+    }
+
+    // Only the bounds of the mesh are used
+    Mesh mesh;
+    mesh.bound_min = vec3(-0.9, -0.9, -0.9);
+    mesh.bound_max = vec3(0.9, 0.9, 0.9);
+    mesh.bound_center = vec3(0, 0, 0);
+    mesh.bound_radius = 0.9 * sqrt(3.0);
+
+    Camera camera(vec3(0, 0, -40), vec3());
+    Frustum frustum = camera.GetFrustum();
+
+    printf("%d iterations, best time in ms, %.1f%% moved before each refit\n", iterations, moved_percent);
+    printf("%10s %8s %10s %10s %10s %10s  %s\n", "instances", "visible", "build", "query", "test all", "refit", "result");
+
+    const int sizes[] = {1000, 10000, 100000, 1000000};
+    for (int count : sizes) {
+        // One instance per 16 square units of floor
+        srand(1);
+        float side = 2.0 * sqrt(count * 16.0);
+        Scene scene;
+        for (int i = 0; i < count; i++) {
+            Instance instance(&mesh, NULL);
+            instance.Rotate(Random(0, 6.3), Random(0, 6.3), Random(0, 6.3));
+            instance.Translate(vec3(Random(-side / 2, side / 2), Random(-5, 5), Random(-40, side - 40)));
+            scene.Add(instance);
+        }
+
+        double build = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            Clock::time_point start = Clock::now();
+            scene.Build();
+            build = std::min(build, Seconds(start));
+        }
+
+        std::vector< Instance* > visible;
+        double query = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            visible.clear();
+            Clock::time_point start = Clock::now();
+            scene.Query(frustum, visible);
+            query = std::min(query, Seconds(start));
+        }
+
+        // Every instance box tested, as without the hierarchy
+        std::vector< Instance* > all;
+        double test_all = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            all.clear();
+            Clock::time_point start = Clock::now();
+            for (Instance &instance : scene.instances) {
+                vec3 min, max;
+                mesh.WorldBounds(instance.ModelMatrix(), min, max);
+                if (frustum.TestBox(min, max) != FRUSTUM_OUTSIDE) {
+                    all.push_back(&instance);
+                }
+            }
+            test_all = std::min(test_all, Seconds(start));
+        }
+
+        // Nudge a spread of instances, then refit through the next query
+        int moved = (int)(count * moved_percent / 100.0);
+        int stride = moved > 0 ? count / moved : count;
+        double refit = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            for (int j = 0; j < moved; j++) {
+                Instance &instance = scene.instances[j * stride];
+                instance.Translate(vec3(instance.translate_matrix[3] + (k % 2 ? -0.1 : 0.1), instance.translate_matrix[7],
+                    instance.translate_matrix[11]));
+            }
+            Clock::time_point start = Clock::now();
+            scene.Refit();
+            refit = std::min(refit, Seconds(start));
+        }
+
+        visible.clear();
+        scene.Query(frustum, visible);
+        all.clear();
+        for (Instance &instance : scene.instances) {
+            vec3 min, max;
+            mesh.WorldBounds(instance.ModelMatrix(), min, max);
+            if (frustum.TestBox(min, max) != FRUSTUM_OUTSIDE) {
+                all.push_back(&instance);
+            }
+        }
+        printf("%10d %8zu %10.3f %10.3f %10.3f %10.3f  %s\n", count, visible.size(), 1000 * build, 1000 * query,
+            1000 * test_all, 1000 * refit, visible == all ? "matches testing every box" : "DIFFERS");
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Per pixel cost of Phong shading in ns/pixel.
+//
+//   make bench && ./bin/bench_shade [--iterations n] [--pixels n]
+//
+// Replays the work PhongShader does in the span loop: step the
+// interpolated normal, normalize it, light it and convert to RGB bytes.
+// Spans are 64 pixels between random unit normals. Each shininess used by
+// larp's materials is timed with Material::Specular and with the pow call
+// it replaced.
+#include "../lib/illumination.h"
+#include "../lib/vec3.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int SPAN = 64;
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration< double >(Clock::now() - start).count();
+}
+
+// Material::PhongIllumination as it was, with pow per pixel
+static vec3 PowIllumination(Material &m, vec3 surface_color, vec3 view, vec3 normal, vec3 light_direction, Light light) {
+    vec3 V = view;
+    vec3 N = normal;
+    vec3 L = light_direction;
+    vec3 R = 2 * (N.dot(L)) * N - L;
+    vec3 i_ambient = m.k_ambient * surface_color;
+    vec3 i_diffuse = m.k_diffuse * (N.dot(L)) * surface_color;
+    vec3 i_specular = vec3();
+    if (V.dot(R) > 0)
+        i_specular = m.k_specular * pow(V.dot(R), m.shininess) * light.color;
+    return i_ambient + i_diffuse + i_specular;
+}
+
+static vec3 RandomNormal(void) {
+    vec3 n(rand() / (float)RAND_MAX - 0.5f, rand() / (float)RAND_MAX - 0.5f, -rand() / (float)RAND_MAX);
+    return n.normalize();
+}
+
+int main(int argc, char* args[]) {
+    int iterations = 20;
+    int pixels = 1 << 18;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(atoi(args[++i]), 1);
+        }
+        else if (strcmp(args[i], "--pixels") == 0 && i + 1 < argc) {
+            pixels = std::max(atoi(args[++i]), SPAN);
+        }
+    }
+    int spans = pixels / SPAN;
+    pixels = spans * SPAN;
+
+    srand(1);
+    std::vector< vec3 > ends(spans + 1);
+    for (vec3 &n : ends) {
+        n = RandomNormal();
+    }
+
+    Light light(vec3(10, 10, -10), vec3(1, 1, 1));
+    vec3 view(0, 0, -1);
+    vec3 light_direction = vec3(10, 10, -10).normalize();
+    std::vector< unsigned char > rgb(3 * pixels);
+
+    printf("%d pixels, %d iterations, best time\n", pixels, iterations);
+    printf("%-9s %-9s %12s %10s %10s  %s\n", "shininess", "specular", "max error", "ms", "ns/pixel", "checksum");
+    for (int shininess : {3, 15, 30}) {
+        Material material(vec3(1, 1, 1), 0.2, 0.6, 0.6, shininess);
+        for (int use_pow = 1; use_pow >= 0; use_pow--) {
+            double best = 1e30;
+            for (int k = 0; k < iterations; k++) {
+                Clock::time_point start = Clock::now();
+                unsigned char *out = rgb.data();
+                for (int s = 0; s < spans; s++) {
+                    vec3 vec = ends[s];
+                    vec3 step = (ends[s + 1] - ends[s]) / (float)SPAN;
+                    for (int x = 0; x < SPAN; x++) {
+                        vec3 norm = vec;
+                        norm.normalize();
+                        vec3 intensity = use_pow ?
+                            PowIllumination(material, material.color, view, norm, light_direction, light) :
+                            material.PhongIllumination(material.color, view, norm, light_direction, light);
+                        *out++ = (unsigned char)floor(abs(intensity.x) * 255.0);
+                        *out++ = (unsigned char)floor(abs(intensity.y) * 255.0);
+                        *out++ = (unsigned char)floor(abs(intensity.z) * 255.0);
+                        vec += step;
+                    }
+                }
+                best = std::min(best, Seconds(start));
+            }
+
+            unsigned long checksum = 0;
+            for (unsigned char c : rgb) {
+                checksum = checksum * 31 + c;
+            }
+            const char *method = use_pow ? "pow" : "squaring";
+            char error[32] = "";
+            if (!use_pow) {
+                snprintf(error, sizeof(error), "%.3g", material.specular_error);
+            }
+            printf("%-9d %-9s %12s %10.3f %10.2f  %016lx\n", shininess, method, error, 1000 * best, 1e9 * best / pixels, checksum);
+        }
+    }
+    return 0;
+}
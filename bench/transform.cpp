@@ -0,0 +1,110 @@
+// Vertex transform throughput: per vertex mat4 * vec4 against the batch API.
+//
+//   make bench && ./bin/bench_transform [--iterations n] [model.d]
+//
+// Transforms every vertex of the model (default atc.d) as points to vec4
+// and as vectors to vec3, and checks each path against mat4 * vec4.
+#include "../lib/dfile.h"
+#include "../lib/transform.h"
+#include "../lib/vec4.h"
+#include "../lib/mat4.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+static double Seconds(Clock::time_point start) {
+    return std::chrono::duration< double >(Clock::now() - start).count();
+}
+
+static void Report(const char* name, double best, size_t count, bool same) {
+    printf("%-20s %10.3f %10.2f %10.1f  %s\n", name, 1000 * best, 1e9 * best / count, count / best / 1e6,
+        same ? "matches mat4 * vec4" : "DIFFERS");
+}
+
+int main(int argc, char* args[]) {
+    int iterations = 200;
+    const char* path = "assets/dfiles/atc.d";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(args[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(atoi(args[++i]), 1);
+        }
+        else {
+            path = args[i];
+        }
+    }
+
+    std::vector< vec3 > verts;
+    std::vector< int > offsets, indices;
+    if (!ParseDFile(path, verts, offsets, indices, 1)) {
+        printf("Error loading %s\n", path);
+        return 1;
+    }
+    size_t count = verts.size();
+
+    // A perspective * view * model style matrix with every element in use
+    mat4 m(0.93f, -0.12f, 0.35f, 0.10f,
+           0.08f, 1.21f, -0.04f, -0.25f,
+           -0.31f, 0.06f, 0.95f, 2.40f,
+           -0.29f, 0.05f, 0.91f, 2.80f);
+
+    printf("%s: %zu verts, %d iterations, best time\n", path, count, iterations);
+    printf("%-20s %10s %10s %10s\n", "path", "ms", "ns/vert", "Mverts/s");
+
+    // Per vertex reference, the way ProcessVerts used to transform
+    std::vector< vec4 > ref_points(count);
+    std::vector< vec3 > ref_vectors(count);
+    double best = 1e30;
+    for (int k = 0; k < iterations; k++) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            ref_points[i] = m * vec4(verts[i], 1.0);
+        }
+        best = std::min(best, Seconds(start));
+    }
+    Report("points mat4*vec4", best, count, true);
+
+    best = 1e30;
+    for (int k = 0; k < iterations; k++) {
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; i++) {
+            vec4 v = m * vec4(verts[i], 0.0);
+            ref_vectors[i] = vec3(v.x, v.y, v.z);
+        }
+        best = std::min(best, Seconds(start));
+    }
+    Report("vectors mat4*vec4", best, count, true);
+
+    std::vector< vec4 > points(count);
+    std::vector< vec3 > vectors(count);
+    for (int p = TRANSFORM_SCALAR; p <= TRANSFORM_AVX2; p++) {
+        if (!SetTransformPath((TransformPath)p)) {
+            printf("%-20s not supported by this CPU\n", TransformPathName((TransformPath)p));
+            continue;
+        }
+        char name[64];
+
+        best = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            Clock::time_point start = Clock::now();
+            TransformPoints(m, verts.data(), points.data(), count);
+            best = std::min(best, Seconds(start));
+        }
+        snprintf(name, sizeof(name), "points %s", TransformPathName((TransformPath)p));
+        Report(name, best, count, memcmp(points.data(), ref_points.data(), count * sizeof(vec4)) == 0);
+
+        best = 1e30;
+        for (int k = 0; k < iterations; k++) {
+            Clock::time_point start = Clock::now();
+            TransformVectors(m, verts.data(), vectors.data(), count);
+            best = std::min(best, Seconds(start));
+        }
+        snprintf(name, sizeof(name), "vectors %s", TransformPathName((TransformPath)p));
+        Report(name, best, count, memcmp(vectors.data(), ref_vectors.data(), count * sizeof(vec3)) == 0);
+    }
+    return 0;
+}
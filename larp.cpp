@@ -4,35 +4,118 @@
 #include "lib/mat4.h"
 #include "lib/vec3.h"
 #include "lib/model.h"
+#include "lib/scene.h"
 #include "lib/camera.h"
 #include "lib/constants.h"
 #include "lib/utils.h"
 #include "lib/illumination.h"
+#include "lib/framebuffer.h"
+#include "lib/depthbuffer.h"
+#include "lib/gbuffer.h"
+#include "lib/profiler.h"
+#include "lib/benchmark.h"
+#include "lib/transform.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
 #include <assert.h>
 #include <string>
+#include <string.h>
+#include <stdlib.h>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <thread>
 
 // Globals
 SDL_Window *g_window = NULL;        // The window we'll be rendering to
 SDL_Renderer *g_renderer = NULL;    // The window renderer
-float g_buffer[SCREEN_WIDTH][SCREEN_HEIGHT]; // Z buffer
+Framebuffer g_framebuffer(SCREEN_WIDTH, SCREEN_HEIGHT); // Color buffer
+DepthBuffer g_depth(SCREEN_WIDTH, SCREEN_HEIGHT); // Z buffer
+int g_width = SCREEN_WIDTH;                 // Size of both buffers and the window
+int g_height = SCREEN_HEIGHT;
+
+// Run settings (overridden by command line arguments)
+bool g_headless = false;                    // Render offscreen without a window
+int g_frames = 100;                         // Number of frames to render when headless
+bool g_frames_set = false;                  // --frames was given
+RenderType g_render_type = RENDER_TYPE;
+RasterType g_raster_type = RASTER_TYPE;
+int g_threads = RENDER_THREADS;             // Threads rasterizing screen tiles, 0 for one per core
+bool g_scaling = false;                     // Time the headless run for every thread count up to g_threads
+TileRenderer *g_tiles = NULL;               // Shared by all models, NULL when single threaded
+bool g_deferred = DEFERRED_SHADING;         // Shade each pixel once after all faces are drawn
+GBuffer *g_gbuffer = NULL;                  // Shared by all models, NULL for forward shading
+bool g_profile = false;                     // Report per stage times and counters at the end of the run
+const char *g_profile_path = NULL;          // Also write the report to this CSV or JSON file
+Profiler *g_profiler = NULL;                // Shared by all models, NULL when not recording
+const char *g_model0_path = MODEL_0;
+int g_instances = 1;                        // Copies of model 0 drawn in a grid, sharing one mesh
+const char *g_texture0_path = TEXTURE_0;
+const char *g_output_path = NULL;           // Write the last headless frame to this PPM file
+bool g_use_cache = MESH_CACHE;              // Load models through their binary mesh cache
+const char *g_convert_path = NULL;          // Convert this .d model to a binary mesh and exit
+const char *g_benchmark_path = NULL;        // Run the benchmark suite and write its results to this JSON file
+const char *g_baseline_path = NULL;         // Compare the benchmark against this earlier result
+double g_threshold = BENCHMARK_THRESHOLD;   // Percent slower p50 flagged as a regression
 
 // Scene
-Model g_model0;
+Scene g_scene;                              // g_instances of mesh 0, then one of mesh 1
+std::vector< Instance* > g_visible;         // instances the scene finds in view this frame
+Mesh g_mesh0;
+Model g_model0;                             // Draws the visible instances of g_mesh0
+Material g_material0;
+std::vector< Instance* > g_draw0;
 Camera g_camera;
 Light g_light;
-Material g_material0;
 #ifdef MODEL_1
+Mesh g_mesh1;
 Model g_model1;
 Material g_material1;
+std::vector< Instance* > g_draw1;
 #endif
 
 
+// Names accepted by --render, indexed by RenderType
+const char *RENDER_TYPE_NAMES[] = {
+    "wireframe",
+    "faces",
+    "depth",
+    "normal",
+    "flat",
+    "gouraud",
+    "phong",
+    "texture",
+    "environment",
+};
+
+// Names accepted by --raster, indexed by RasterType
+const char *RASTER_TYPE_NAMES[] = {
+    "scanline",
+    "halfspace",
+};
+
 bool init(void)
 {
+    if (g_headless) {
+        #ifdef DIRECT_DRAW
+        printf("Headless mode requires the framebuffer, undefine DIRECT_DRAW\n");
+        return false;
+        #endif
+
+        // No video subsystem, only what is needed to load textures
+        if (SDL_Init(0) < 0) {
+            printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+            return false;
+        }
+        int img_flags = IMG_INIT_PNG;
+        if (!(IMG_Init(img_flags) & img_flags)) {
+            printf("SDL_image could not initialize. SDL_image Error: %s\n", IMG_GetError());
+            return false;
+        }
+        return true;
+    }
+
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
@@ -45,7 +128,7 @@ bool init(void)
     }
 
     // Create window
-    g_window = SDL_CreateWindow(WINDOW_NAME, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+    g_window = SDL_CreateWindow(WINDOW_NAME, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, g_width, g_height, SDL_WINDOW_SHOWN);
     if(g_window == NULL) {
         printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
         return false;
@@ -58,6 +141,11 @@ bool init(void)
         return false;
     }
 
+    // Create streaming texture for the color buffer
+    if (!g_framebuffer.Init(g_renderer)) {
+        return false;
+    }
+
     // Initialize PNG loading
     int img_flags = IMG_INIT_PNG;
     if (!(IMG_Init(img_flags) & img_flags)) {
@@ -74,11 +162,23 @@ bool init(void)
 void end(void) 
 {
 	// Destroy window
-    SDL_DestroyRenderer(g_renderer);
-	SDL_DestroyWindow(g_window);
+    g_framebuffer.Free();
+    if (g_renderer != NULL) {
+        SDL_DestroyRenderer(g_renderer);
+    }
+    if (g_window != NULL) {
+        SDL_DestroyWindow(g_window);
+    }
     g_window = NULL;
     g_renderer = NULL;
 
+    delete g_tiles;
+    g_tiles = NULL;
+    delete g_gbuffer;
+    g_gbuffer = NULL;
+    delete g_profiler;
+    g_profiler = NULL;
+
 	// Quit SDL subsystems
     IMG_Quit();
 	SDL_Quit();
@@ -124,114 +224,583 @@ void initScene()
     }
     assert((k_ambient + k_diffuse + k_specular) <= 1.0);
     g_material0 = Material(material_color0, k_ambient, k_diffuse, k_specular, shininess);
-    if (RENDER_TYPE == TEXTURE || RENDER_TYPE == ENVIRONMENT) {
-        if(!g_material0.LoadTexture(TEXTURE_0)) {
+    if (g_render_type == TEXTURE) {
+        if(!g_material0.LoadTexture(g_texture0_path)) {
             printf("Error loading texture\n");
             exit(1);
         }
     }
+    else if (g_render_type == ENVIRONMENT) {
+        if(!g_material0.LoadEnvironment(g_texture0_path)) {
+            printf("Error loading environment map\n");
+            exit(1);
+        }
+    }
     #ifdef MODEL_1
     vec3 material_color1 = vec3(0.0, 0.0, 1.0);
     g_material1 = Material(material_color1, k_ambient, k_diffuse, k_specular, shininess);
-    if (RENDER_TYPE == TEXTURE || RENDER_TYPE == ENVIRONMENT) {
+    if (g_render_type == TEXTURE) {
         g_material1.LoadTexture(TEXTURE_1);
     }
+    else if (g_render_type == ENVIRONMENT) {
+        g_material1.LoadEnvironment(TEXTURE_1);
+    }
     #endif
 
     // Load objects
-    g_model0 = Model();
-    g_model0.LoadModel(MODEL_0);
+    Uint64 load_start = SDL_GetPerformanceCounter();
+    if (!g_mesh0.LoadModel(g_model0_path, g_use_cache)) {
+        printf("Error loading model %s\n", g_model0_path);
+        exit(1);
+    }
+    Uint64 load_stop = SDL_GetPerformanceCounter();
+    if (g_headless && g_benchmark_path == NULL) {
+        printf("Loaded %s in %.3f ms\n", g_model0_path, 1000.0 * (load_stop - load_start) / SDL_GetPerformanceFrequency());
+    }
+    g_model0 = Model(&g_mesh0);
+    g_model0.raster_type = g_raster_type;
+    g_scene.Clear();
+    for (int k = 0; k < g_instances; k++) {
+        g_scene.Add(Instance(&g_mesh0, &g_material0));
+    }
+
+    #ifdef MODEL_1
+    g_mesh1.LoadModel(MODEL_1, g_use_cache);
+    g_model1 = Model(&g_mesh1);
+    g_model1.raster_type = g_raster_type;
+    g_scene.Add(Instance(&g_mesh1, &g_material1));
+    #endif
 
+    setThreads(g_threads);
+
+    // Draws resize the G-buffer to the depth buffer
+    delete g_gbuffer;
+    g_gbuffer = g_deferred ? new GBuffer(g_width, g_height) : NULL;
+    g_model0.gbuffer = g_gbuffer;
+    #ifdef MODEL_1
+    g_model1.gbuffer = g_gbuffer;
+    #endif
+
+    // Headless runs always record, for the summary
+    delete g_profiler;
+    g_profiler = g_headless || g_profile ? new Profiler() : NULL;
+    g_model0.profiler = g_profiler;
+    #ifdef MODEL_1
+    g_model1.profiler = g_profiler;
+    #endif
+}
+
+void setThreads(int threads)
+{
+    // A single thread draws every face directly, without binning
+    delete g_tiles;
+    g_tiles = threads > 1 ? new TileRenderer(threads) : NULL;
+    g_model0.tiles = g_tiles;
+    #ifdef MODEL_1
+    g_model1.tiles = g_tiles;
+    #endif
+}
+
+void updateScene(float angle)
+{
+    vec3 cam_pos = vec3(0.0, 0.0, -40.0);
+    g_camera = Camera(cam_pos, vec3());
+    g_camera.aspect_ratio = (float)g_width / g_height;
+
+    // Instances of model 0 fill a square grid, a single one fills the view
+    int columns = (int)ceil(sqrt((double)g_instances));
+    int rows = (g_instances + columns - 1) / columns;
+    float cell = 72.0 / columns;
+    vec3 offset(0, 0, 0);
     #ifdef MODEL_1
-    g_model1 = Model();
-    g_model1.LoadModel(MODEL_1);
+    offset = vec3(10,0,0);
     #endif
 
-    
+    // rotate around Z-axis
+    for (int k = 0; k < g_instances; k++) {
+        Instance &instance = g_scene.instances[k];
+        instance.Scale(16.0 / columns);
+        instance.Rotate(0.0, angle + k, M_PI); 
+        vec3 cell_offset((k % columns - 0.5 * (columns - 1)) * cell, (k / columns - 0.5 * (rows - 1)) * cell, 0);
+        instance.Translate(offset + cell_offset);
+    }
+
+    #ifdef MODEL_1
+    Instance &instance1 = g_scene.instances[g_instances];
+    instance1.Scale(16);
+    instance1.Rotate(0.0, -angle, M_PI); 
+    instance1.Translate(vec3(-10,0,0));
+    #endif
 }
 
 void renderScene()
 {
     //Clear screen
-    SDL_SetRenderDrawColor(g_renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-    SDL_RenderClear(g_renderer);
+    Uint64 start = ProfileStart(g_profiler);
+    g_framebuffer.Clear(0xFF, 0xFF, 0xFF);
 
     // Clear the z buffer 
-    for (int x = 0; x < SCREEN_WIDTH; x++) {
-        for (int y = 0; y < SCREEN_HEIGHT; y++) {
-            g_buffer[x][y] = 1.0;
+    g_depth.Clear(1.0);
+    ProfileLap(g_profiler, PROFILE_CLEAR, start);
+
+    // Only the instances the scene finds in view reach the models
+    start = ProfileStart(g_profiler);
+    g_visible.clear();
+    g_scene.Query(g_camera.GetFrustum(), g_visible);
+    g_draw0.clear();
+    #ifdef MODEL_1
+    g_draw1.clear();
+    #endif
+    for (Instance *instance : g_visible) {
+        #ifdef MODEL_1
+        if (instance->mesh == &g_mesh1) {
+            g_draw1.push_back(instance);
+            continue;
+        }
+        #endif
+        g_draw0.push_back(instance);
+    }
+    ProfileLap(g_profiler, PROFILE_CULL, start);
+    if (g_profiler) {
+        // Faces of culled instances count as seen and culled, as those culled inside a draw do
+        Uint64 culled_faces = 0;
+        for (const Instance &instance : g_scene.instances) {
+            culled_faces += instance.mesh->NumFaces();
+        }
+        for (const Instance *instance : g_visible) {
+            culled_faces -= instance->mesh->NumFaces();
         }
+        g_profiler->Count(PROFILE_INSTANCES_CULLED, g_scene.NumInstances() - g_visible.size());
+        g_profiler->Count(PROFILE_FACES, culled_faces);
+        g_profiler->Count(PROFILE_CULLED, culled_faces);
     }
 
     // Redraw models
-    switch (RENDER_TYPE) {
-        case WIREFRAME:
-            g_model0.DrawEdges(g_camera, g_renderer);
-            #ifdef MODEL_1
-            g_model1.DrawEdges(g_camera, g_renderer);
-            #endif
-            break;
-        case FACES:
-            g_model0.DrawFaces(g_camera, g_renderer, g_buffer, false);
-            #ifdef MODEL_1
-            g_model1.DrawFaces(g_camera, g_renderer, g_buffer, false);
-            #endif
-            break;
-        case DEPTH:
-            g_model0.DrawFaces(g_camera, g_renderer, g_buffer, true);
-            #ifdef MODEL_1
-            g_model1.DrawFaces(g_camera, g_renderer, g_buffer, true);
-            #endif
-            break;
-        case FLAT:
-            g_model0.DrawFlat(g_camera, g_light, g_material0, g_renderer, g_buffer);
-            #ifdef MODEL_1
-            g_model1.DrawFlat(g_camera, g_light, g_material1, g_renderer, g_buffer);
-            #endif
-            break;
-        case GOURAUD:
-            g_model0.DrawGouraud(g_camera, g_light, g_material0, g_renderer, g_buffer);
-            #ifdef MODEL_1
-            g_model1.DrawGouraud(g_camera, g_light, g_material1, g_renderer, g_buffer);
-            #endif
-            break;
-        case PHONG:
-            g_model0.DrawPhong(g_camera, g_light, g_material0, g_renderer, g_buffer, false);
-            #ifdef MODEL_1
-            g_model1.DrawPhong(g_camera, g_light, g_material1, g_renderer, g_buffer, false);
-            #endif
-            break;
-        case NORMAL:
-            g_model0.DrawPhong(g_camera, g_light, g_material0, g_renderer, g_buffer, true);
-            #ifdef MODEL_1
-            g_model1.DrawPhong(g_camera, g_light, g_material1, g_renderer, g_buffer, true);
-            #endif
-            break;
-        case ENVIRONMENT:
-            g_model0.DrawEnvironment(g_camera, g_light, g_material0, g_renderer, g_buffer);
-            #ifdef MODEL_1
-            g_model1.DrawEnvironment(g_camera, g_light, g_material1, g_renderer, g_buffer);
-            #endif
-            break;
-        case TEXTURE:
-            g_model0.DrawTexture(g_camera, g_light, g_material0, g_renderer, g_buffer);
-            #ifdef MODEL_1
-            g_model1.DrawTexture(g_camera, g_light, g_material1, g_renderer, g_buffer);
-            #endif
-            break;
+    g_model0.Render(g_render_type, g_camera, g_light, g_draw0, g_framebuffer, g_depth);
+    #ifdef MODEL_1
+    g_model1.Render(g_render_type, g_camera, g_light, g_draw1, g_framebuffer, g_depth);
+    #endif
+
+    // Deferred draws only stored their fragments, shade each covered pixel once
+    if (g_gbuffer) {
+        ShadeDeferred(g_render_type, g_camera, g_light, *g_gbuffer, g_tiles, g_profiler, g_framebuffer, g_depth);
     }
 
     // Update screen
-    SDL_RenderPresent(g_renderer);
+    if (!g_headless) {
+        start = ProfileStart(g_profiler);
+        g_framebuffer.Present();
+        ProfileLap(g_profiler, PROFILE_PRESENT, start);
+    }
+}
+
+void timeFrames(std::vector< double > &times, bool print_frames)
+{
+    // Render a fixed number of frames as fast as possible and time each one
+    times.resize(g_frames);
+    if (g_profiler) {
+        g_profiler->Reset();
+    }
+    double frequency = (double)SDL_GetPerformanceFrequency();
+
+    float i = M_PI;     // rotate
+    for (int frame = 0; frame < g_frames; frame++) {
+        updateScene(i);
+
+        if (g_profiler) {
+            g_profiler->BeginFrame();
+        }
+        Uint64 start = SDL_GetPerformanceCounter();
+        renderScene();
+        Uint64 stop = SDL_GetPerformanceCounter();
+        if (g_profiler) {
+            g_profiler->EndFrame();
+        }
+
+        times[frame] = 1000.0 * (stop - start) / frequency;
+        if (print_frames) {
+            printf("Frame %d: %.3f ms\n", frame, times[frame]);
+        }
+
+        if (ANIMATE) {
+            i += ROTATION_SPEED;
+        }
+    }
+}
+
+bool renderHeadless(void)
+{
+    std::vector< double > times;
+    timeFrames(times, true);
+
+    if (g_frames > 0) {
+        double total = 0.0;
+        for (int frame = 0; frame < g_frames; frame++) {
+            total += times[frame];
+        }
+        double min = *std::min_element(times.begin(), times.end());
+        double max = *std::max_element(times.begin(), times.end());
+        double avg = total / g_frames;
+        printf("%s %s %s, %d threads: %d frames, min %.3f ms, avg %.3f ms, max %.3f ms, %.1f FPS\n",
+            g_model0_path, RENDER_TYPE_NAMES[g_render_type], RASTER_TYPE_NAMES[g_raster_type], g_threads, g_frames, min, avg, max, 1000.0 / avg);
+        printf("%s shading: %.0f fragments drawn, %.0f pixels shaded per frame\n", g_deferred ? "Deferred" : "Forward",
+            g_profiler->CounterMean(PROFILE_WRITTEN), g_profiler->CounterMean(PROFILE_SHADED));
+    }
+    bool ok = reportProfile();
+
+    if (g_output_path != NULL && !g_framebuffer.SavePPM(g_output_path)) {
+        printf("Error writing %s\n", g_output_path);
+        ok = false;
+    }
+    return ok;
+}
+
+void renderScaling(void)
+{
+    // Time the same frames for 1..g_threads threads and check the last frame matches the serial one
+    printf("%s %s %s, %d frames\n", g_model0_path, RENDER_TYPE_NAMES[g_render_type], RASTER_TYPE_NAMES[g_raster_type], g_frames);
+    printf("threads   avg ms      FPS  speedup  efficiency  output\n");
+
+    std::vector< double > times;
+    std::vector< Uint32 > serial;
+    double serial_avg = 0.0;
+    for (int threads = 1; threads <= g_threads; threads++) {
+        setThreads(threads);
+        timeFrames(times, false);
+
+        double total = 0.0;
+        for (size_t frame = 0; frame < times.size(); frame++) {
+            total += times[frame];
+        }
+        double avg = total / std::max(g_frames, 1);
+        if (threads == 1) {
+            serial = g_framebuffer.color;
+            serial_avg = avg;
+        }
+        double speedup = serial_avg / avg;
+        printf("%7d %8.3f %8.1f %8.2f %10.0f%%  %s\n", threads, avg, 1000.0 / avg, speedup, 100.0 * speedup / threads,
+            g_framebuffer.color == serial ? "identical" : "DIFFERS");
+    }
+    setThreads(g_threads);
+}
+
+void setSize(int width, int height)
+{
+    g_width = width;
+    g_height = height;
+    g_framebuffer.Resize(width, height);
+    g_depth.Resize(width, height);
+    g_camera.aspect_ratio = (float)width / height;
+}
+
+bool renderBenchmark(void)
+{
+    // Every model and render type at each size, viewed from the same seeded
+    // rotations, so runs of different builds time identical work
+    const int sizes[][2] = {{320, 240}, {800, 600}, {1920, 1080}};
+    std::vector< std::string > models = BenchmarkModels(BENCHMARK_MODELS);
+    if (models.empty()) {
+        printf("No models in %s\n", BENCHMARK_MODELS);
+        return false;
+    }
+    int frames = g_frames_set ? g_frames : BENCHMARK_FRAMES;
+
+    BenchmarkRun run;
+    run.threads = g_threads;
+    run.raster = RASTER_TYPE_NAMES[g_raster_type];
+    run.deferred = g_deferred;
+    printf("Benchmark: %zu models, %d render types, %d sizes, %d frames each, %d threads, %s, %s\n",
+        models.size(), ENVIRONMENT + 1, (int)(sizeof(sizes) / sizeof(sizes[0])), frames, g_threads,
+        run.raster.c_str(), g_deferred ? "deferred" : "forward");
+    printf("%-36s %10s %10s %10s %12s %12s\n", "case", "p50 ms", "p95 ms", "max ms", "tris/s", "frags/s");
+
+    for (const int *size : sizes) {
+        setSize(size[0], size[1]);
+        for (const std::string &path : models) {
+            for (int type = 0; type <= ENVIRONMENT; type++) {
+                g_model0_path = path.c_str();
+                g_render_type = (RenderType)type;
+                initScene();
+
+                for (int frame = 0; frame < BENCHMARK_WARMUP; frame++) {
+                    updateScene(BenchmarkAngle(run.seed, frame));
+                    renderScene();
+                }
+                g_profiler->Reset();
+                for (int frame = 0; frame < frames; frame++) {
+                    updateScene(BenchmarkAngle(run.seed, BENCHMARK_WARMUP + frame));
+                    g_profiler->BeginFrame();
+                    renderScene();
+                    g_profiler->EndFrame();
+                }
+
+                BenchmarkCase c;
+                c.model = path.substr(path.find_last_of('/') + 1);
+                c.render = RENDER_TYPE_NAMES[type];
+                c.width = g_width;
+                c.height = g_height;
+                c.frames = frames;
+                c.frame_ms = ProfileSummary(g_profiler->frame_times);
+                int triangles = g_mesh0.NumTriangles() * g_instances;
+                #ifdef MODEL_1
+                triangles += g_mesh1.NumTriangles();
+                #endif
+                if (c.frame_ms.mean > 0) {
+                    c.triangles_per_s = 1000.0 * triangles / c.frame_ms.mean;
+                    c.fragments_per_s = 1000.0 * g_profiler->CounterMean(PROFILE_WRITTEN) / c.frame_ms.mean;
+                }
+                printf("%-36s %10.3f %10.3f %10.3f %12.4g %12.4g\n", c.Name().c_str(), c.frame_ms.p50, c.frame_ms.p95,
+                    c.frame_ms.max, c.triangles_per_s, c.fragments_per_s);
+                run.cases.push_back(c);
+            }
+        }
+    }
+
+    if (!run.Write(g_benchmark_path)) {
+        return false;
+    }
+    printf("Wrote %s\n", g_benchmark_path);
+
+    if (g_baseline_path != NULL) {
+        BenchmarkRun baseline;
+        if (!baseline.Read(g_baseline_path)) {
+            return false;
+        }
+        printf("Compared with %s\n", g_baseline_path);
+        if (run.Compare(baseline, g_threshold) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool reportProfile(void)
+{
+    if (g_profiler == NULL || !g_profile) {
+        return true;
+    }
+    g_profiler->Print();
+    if (g_profile_path == NULL) {
+        return true;
+    }
+    if (!g_profiler->Write(g_profile_path)) {
+        return false;
+    }
+    printf("Wrote %s\n", g_profile_path);
+    return true;
+}
+
+bool convertModel(void)
+{
+    Sint64 mtime = 0;
+    Uint64 size = 0;
+    Mesh mesh;
+    if (!FileStamp(g_convert_path, mtime, size) || !mesh.LoadD(g_convert_path)) {
+        printf("Error loading model %s\n", g_convert_path);
+        return false;
+    }
+
+    std::string output = g_output_path ? g_output_path : std::string(g_convert_path) + MESH_CACHE_EXT;
+    if (!mesh.SaveMesh(output.c_str(), mtime, size)) {
+        return false;
+    }
+    printf("Wrote %s: %zu verts, %d faces\n", output.c_str(), mesh.verts.size(), mesh.NumFaces());
+    return true;
+}
 
+void usage(const char *name)
+{
+    printf("Usage: %s [options]\n", name);
+    printf("  --headless          render offscreen without a window\n");
+    printf("  --frames <n>        number of frames to render when headless (default %d)\n", g_frames);
+    printf("  --model <path>      .d model file (default %s)\n", MODEL_0);
+    printf("  --texture <path>    texture or environment map (default %s)\n", TEXTURE_0);
+    printf("  --instances <n>     draw n copies of the model in a grid, sharing its mesh (default 1)\n");
+    printf("  --render <type>     wireframe, faces, depth, normal, flat, gouraud, phong, texture, environment\n");
+    printf("  --raster <type>     scanline, halfspace\n");
+    printf("  --simd <path>       vertex transform path: scalar, sse2, avx2 (default: best the CPU supports)\n");
+    printf("  --threads <n>       threads rasterizing screen tiles, 0 for one per core (default %d)\n", RENDER_THREADS);
+    printf("  --scaling           with --headless, report timings for 1..threads threads\n");
+    printf("  --deferred          shade phong, texture and environment once per pixel through a G-buffer\n");
+    printf("  --forward           shade every fragment that passes the depth test\n");
+    printf("  --profile           report p50/p95/p99 of per stage times and counters at the end of the run\n");
+    printf("  --profile-output <path>  with --profile, also write the report as CSV, or JSON for a .json path\n");
+    printf("  --size <w>x<h>      screen size in pixels (default %dx%d)\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+    printf("  --benchmark <path>  render every model in %s with every render type at 320x240, 800x600 and\n", BENCHMARK_MODELS);
+    printf("                      1920x1080 from a fixed seeded rotation script and write the timings as JSON\n");
+    printf("  --baseline <path>   with --benchmark, compare against an earlier result and fail on regressions\n");
+    printf("  --threshold <pct>   with --baseline, percent slower p50 frame time that counts as a regression (default %.0f)\n", BENCHMARK_THRESHOLD);
+    printf("  --output <path>     write the last headless frame to a PPM file, or the --convert output\n");
+    printf("  --no-cache          parse .d models instead of loading their binary mesh cache\n");
+    printf("  --convert <path>    write a .d model as a binary mesh (default <path>%s) and exit\n", MESH_CACHE_EXT);
+}
+
+bool parseArgs(int argc, char* args[])
+{
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(args[i], "--headless") == 0) {
+            g_headless = true;
+        }
+        else if (strcmp(args[i], "--scaling") == 0) {
+            g_scaling = true;
+        }
+        else if (strcmp(args[i], "--deferred") == 0) {
+            g_deferred = true;
+        }
+        else if (strcmp(args[i], "--forward") == 0) {
+            g_deferred = false;
+        }
+        else if (strcmp(args[i], "--profile") == 0) {
+            g_profile = true;
+        }
+        else if (strcmp(args[i], "--profile-output") == 0 && has_value) {
+            g_profile = true;
+            g_profile_path = args[++i];
+        }
+        else if (strcmp(args[i], "--simd") == 0 && has_value) {
+            const char *name = args[++i];
+            int path = TRANSFORM_SCALAR;
+            while (path <= TRANSFORM_AVX2 && strcmp(name, TransformPathName((TransformPath)path)) != 0) {
+                path++;
+            }
+            if (path > TRANSFORM_AVX2 || !SetTransformPath((TransformPath)path)) {
+                printf("Unknown or unsupported SIMD path %s\n", name);
+                return false;
+            }
+        }
+        else if (strcmp(args[i], "--no-cache") == 0) {
+            g_use_cache = false;
+        }
+        else if (strcmp(args[i], "--convert") == 0 && has_value) {
+            g_convert_path = args[++i];
+        }
+        else if (strcmp(args[i], "--threads") == 0 && has_value) {
+            char *end = NULL;
+            long threads = strtol(args[++i], &end, 10);
+            if (end == args[i] || *end != '\0' || threads < 0 || threads > MAX_RENDER_THREADS) {
+                printf("Invalid thread count %s, expected 0 to %d\n", args[i], MAX_RENDER_THREADS);
+                return false;
+            }
+            g_threads = threads;
+        }
+        else if (strcmp(args[i], "--frames") == 0 && has_value) {
+            g_frames = atoi(args[++i]);
+            if (g_frames < 0) {
+                printf("Invalid frame count %s\n", args[i]);
+                return false;
+            }
+            g_frames_set = true;
+        }
+        else if (strcmp(args[i], "--size") == 0 && has_value) {
+            int width = 0, height = 0;
+            if (sscanf(args[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                printf("Invalid size %s, expected <width>x<height>\n", args[i]);
+                return false;
+            }
+            setSize(width, height);
+        }
+        else if (strcmp(args[i], "--benchmark") == 0 && has_value) {
+            g_benchmark_path = args[++i];
+            g_headless = true;
+        }
+        else if (strcmp(args[i], "--baseline") == 0 && has_value) {
+            g_baseline_path = args[++i];
+        }
+        else if (strcmp(args[i], "--threshold") == 0 && has_value) {
+            char *end = NULL;
+            g_threshold = strtod(args[++i], &end);
+            if (end == args[i] || *end != '\0' || !(g_threshold >= 0)) {
+                printf("Invalid threshold %s\n", args[i]);
+                return false;
+            }
+        }
+        else if (strcmp(args[i], "--model") == 0 && has_value) {
+            g_model0_path = args[++i];
+        }
+        else if (strcmp(args[i], "--instances") == 0 && has_value) {
+            g_instances = atoi(args[++i]);
+            if (g_instances < 1) {
+                printf("Invalid instance count %s\n", args[i]);
+                return false;
+            }
+        }
+        else if (strcmp(args[i], "--texture") == 0 && has_value) {
+            g_texture0_path = args[++i];
+        }
+        else if (strcmp(args[i], "--output") == 0 && has_value) {
+            g_output_path = args[++i];
+        }
+        else if (strcmp(args[i], "--render") == 0 && has_value) {
+            const char *name = args[++i];
+            int count = sizeof(RENDER_TYPE_NAMES) / sizeof(RENDER_TYPE_NAMES[0]);
+            int type = 0;
+            while (type < count && strcmp(name, RENDER_TYPE_NAMES[type]) != 0) {
+                type++;
+            }
+            if (type == count) {
+                printf("Unknown render type %s\n", name);
+                return false;
+            }
+            g_render_type = (RenderType)type;
+        }
+        else if (strcmp(args[i], "--raster") == 0 && has_value) {
+            const char *name = args[++i];
+            int count = sizeof(RASTER_TYPE_NAMES) / sizeof(RASTER_TYPE_NAMES[0]);
+            int type = 0;
+            while (type < count && strcmp(name, RASTER_TYPE_NAMES[type]) != 0) {
+                type++;
+            }
+            if (type == count) {
+                printf("Unknown raster type %s\n", name);
+                return false;
+            }
+            g_raster_type = (RasterType)type;
+        }
+        else {
+            usage(args[0]);
+            return false;
+        }
+    }
+    return true;
 }
 
 int main(int argc, char* args[])
 {
+    if (!parseArgs(argc, args)) {
+        return 1;
+    }
+    if (g_convert_path) {
+        return convertModel() ? 0 : 1;
+    }
+    if (g_threads <= 0) {
+        g_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    }
+    #ifdef DIRECT_DRAW
+    // SDL draw calls must come from the main thread
+    g_threads = 1;
+    #endif
+
     // Start up SDL and create window
+    bool ok = true;
     if (!init())
     {
         printf("Failed to initialize\n");
+        ok = false;
+    }
+    else if (g_benchmark_path)
+    {
+        ok = renderBenchmark();
+    }
+    else if (g_headless)
+    {
+        initScene();
+        if (g_scaling) {
+            renderScaling();
+        }
+        else {
+            ok = renderHeadless();
+        }
     }
     else 
     {
@@ -245,6 +814,8 @@ int main(int argc, char* args[])
 
         #ifdef DEBUG
         Uint32 last_time = SDL_GetTicks();
+        Uint32 fps_time = last_time;
+        int fps_frames = 0;
         #endif
 
         float i = M_PI;     // rotate
@@ -258,23 +829,15 @@ int main(int argc, char* args[])
                     quit = true;
                 }
             }
-            vec3 cam_pos = vec3(0.0, 0.0, -40.0);
-            g_camera = Camera(cam_pos, vec3());
-
             if (ANIMATE || framecount == 0) {
-                // rotate around Z-axis
-                g_model0.Scale(16);
-                g_model0.Rotate(0.0, i, M_PI); 
-                #ifdef MODEL_1
-                g_model0.Translate(vec3(10,0,0));
-                #endif
-
-                #ifdef MODEL_1
-                g_model1.Scale(16);
-                g_model1.Rotate(0.0, -i, M_PI); 
-                g_model1.Translate(vec3(-10,0,0));
-                #endif
+                updateScene(i);
+                if (g_profiler) {
+                    g_profiler->BeginFrame();
+                }
                 renderScene();
+                if (g_profiler) {
+                    g_profiler->EndFrame();
+                }
 
                 i += ROTATION_SPEED;
                 framecount++;
@@ -289,10 +852,25 @@ int main(int argc, char* args[])
             Uint32 diff = current_time - last_time;
             printf("Time: %d\n", diff);
             last_time = current_time;
+
+            // Report average frames per second once a second
+            fps_frames++;
+            if (current_time - fps_time >= 1000) {
+                #ifdef DIRECT_DRAW
+                const char* backend = "direct draw";
+                #else
+                const char* backend = "framebuffer";
+                #endif
+                printf("FPS: %.1f (%s)\n", 1000.0 * fps_frames / (current_time - fps_time), backend);
+                fps_time = current_time;
+                fps_frames = 0;
+            }
             #endif
         }
+        ok = reportProfile();
 	}
+
     // Free resources and close SDL
     end();
-	return 0;
+	return ok ? 0 : 1;
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <SDL2/SDL.h>
+#include <vector>
 #pragma once
 
 /**
@@ -11,11 +12,64 @@ bool init(void);
  */
 void initScene(void);
 
+/**
+ * Position the camera and models for the given rotation angle
+ */
+void updateScene(float angle);
+
 /**
  * Render scene
  */
 void renderScene(void);
 
+/**
+ * Rasterize with the given number of threads, 1 draws without tiles
+ */
+void setThreads(int threads);
+
+/**
+ * Render g_frames frames, recording the time of each
+ */
+void timeFrames(std::vector< double > &times, bool print_frames);
+
+/**
+ * Render a fixed number of frames offscreen and report timings.
+ * False if the output image or profile can't be written.
+ */
+bool renderHeadless(void);
+
+/**
+ * Report headless timings and speedup for every thread count up to g_threads
+ */
+void renderScaling(void);
+
+/**
+ * Resize the color and depth buffers, before init for the window
+ */
+void setSize(int width, int height);
+
+/**
+ * Time every model and render type at several sizes, write g_benchmark_path
+ * and compare with g_baseline_path. False on errors or regressions.
+ */
+bool renderBenchmark(void);
+
+/**
+ * Print the profiler's report and write it to g_profile_path, if profiling.
+ * False if the file can't be written.
+ */
+bool reportProfile(void);
+
+/**
+ * Write g_convert_path as a binary mesh
+ */
+bool convertModel(void);
+
+/**
+ * Parse command line arguments into the run settings
+ */
+bool parseArgs(int argc, char* args[]);
+
 /**
  * Frees media and shuts down SDL
  */
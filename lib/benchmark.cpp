@@ -0,0 +1,176 @@
+#define _USE_MATH_DEFINES
+
+#include "benchmark.h"
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <dirent.h>
+
+float BenchmarkAngle(Uint32 seed, int frame) {
+    // splitmix32 style mix of seed and frame
+    Uint32 h = seed * 0x9E3779B9u + (Uint32)frame;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return (float)(2.0 * M_PI * (h / 4294967296.0));
+}
+
+std::vector< std::string > BenchmarkModels(const char* dir) {
+    std::vector< std::string > paths;
+    DIR *d = opendir(dir);
+    if (d == NULL) {
+        printf("Unable to open directory %s\n", dir);
+        return paths;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length > 2 && strcmp(entry->d_name + length - 2, ".d") == 0) {
+            paths.push_back(std::string(dir) + "/" + entry->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+//================================
+// BenchmarkCase
+//================================
+
+std::string BenchmarkCase::Name(void) const {
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", width, height);
+    return model + " " + render + " " + size;
+}
+
+//================================
+// BenchmarkRun
+//================================
+
+// Case lines are written with BENCHMARK_CASE_FORMAT("%s") and read back with
+// BENCHMARK_CASE_FORMAT(BENCHMARK_NAME_SCAN), so the two can't drift apart.
+// Keep BENCHMARK_CASE_FIELDS in step with the number of conversions.
+#define BENCHMARK_CASE_FORMAT(NAME) "    {\"model\": \"" NAME "\", \"render\": \"" NAME "\", \"width\": %d, \"height\": %d, \"frames\": %d, " \
+    "\"mean_ms\": %lf, \"p50_ms\": %lf, \"p95_ms\": %lf, \"p99_ms\": %lf, \"max_ms\": %lf, " \
+    "\"triangles_per_s\": %lf, \"fragments_per_s\": %lf}"
+#define BENCHMARK_CASE_FIELDS 12
+
+// Model and render names never contain quotes
+#define BENCHMARK_NAME_SCAN "%255[^\"]"
+
+bool BenchmarkRun::Write(const char* path) const {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Unable to open %s for writing\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"seed\": %u,\n", seed);
+    fprintf(file, "  \"threads\": %d,\n", threads);
+    fprintf(file, "  \"raster\": \"%s\",\n", raster.c_str());
+    fprintf(file, "  \"deferred\": %s,\n", deferred ? "true" : "false");
+    fprintf(file, "  \"cases\": [\n");
+    for (size_t k = 0; k < cases.size(); k++) {
+        const BenchmarkCase &c = cases[k];
+        fprintf(file, BENCHMARK_CASE_FORMAT("%s"), c.model.c_str(), c.render.c_str(), c.width, c.height, c.frames,
+            c.frame_ms.mean, c.frame_ms.p50, c.frame_ms.p95, c.frame_ms.p99, c.frame_ms.max,
+            c.triangles_per_s, c.fragments_per_s);
+        fprintf(file, "%s\n", k + 1 < cases.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool ok = ferror(file) == 0;
+    if (fclose(file) != 0 || !ok) {
+        printf("Error writing %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+bool BenchmarkRun::Read(const char* path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        printf("Unable to open %s\n", path);
+        return false;
+    }
+
+    cases.clear();
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char text[256];
+        if (sscanf(line, "  \"raster\": \"%255[^\"]\"", text) == 1) {
+            raster = text;
+            continue;
+        }
+        sscanf(line, "  \"seed\": %u", &seed);
+        sscanf(line, "  \"threads\": %d", &threads);
+        if (sscanf(line, "  \"deferred\": %255s", text) == 1) {
+            deferred = strncmp(text, "true", 4) == 0;
+        }
+
+        char model[256], render[256];
+        BenchmarkCase c;
+        int fields = sscanf(line, BENCHMARK_CASE_FORMAT(BENCHMARK_NAME_SCAN),
+            model, render, &c.width, &c.height, &c.frames,
+            &c.frame_ms.mean, &c.frame_ms.p50, &c.frame_ms.p95, &c.frame_ms.p99, &c.frame_ms.max,
+            &c.triangles_per_s, &c.fragments_per_s);
+        if (fields == BENCHMARK_CASE_FIELDS) {
+            c.model = model;
+            c.render = render;
+            cases.push_back(c);
+        }
+    }
+    fclose(file);
+
+    if (cases.empty()) {
+        printf("No benchmark cases in %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+int BenchmarkRun::Compare(const BenchmarkRun &baseline, double threshold) const {
+    if (baseline.threads != threads || baseline.raster != raster || baseline.deferred != deferred) {
+        printf("Warning: baseline ran with %d threads, %s, %s\n", baseline.threads, baseline.raster.c_str(),
+            baseline.deferred ? "deferred" : "forward");
+    }
+
+    printf("%-36s %10s %10s %8s\n", "case", "base p50", "p50 ms", "change");
+    int regressions = 0;
+    int improvements = 0;
+    int missing = 0;
+    for (const BenchmarkCase &c : cases) {
+        const BenchmarkCase *base = NULL;
+        for (const BenchmarkCase &b : baseline.cases) {
+            if (b.model == c.model && b.render == c.render && b.width == c.width && b.height == c.height) {
+                base = &b;
+                break;
+            }
+        }
+        if (base == NULL || !(base->frame_ms.p50 > 0)) {
+            missing++;
+            continue;
+        }
+
+        double change = 100.0 * (c.frame_ms.p50 - base->frame_ms.p50) / base->frame_ms.p50;
+        if (change > threshold) {
+            regressions++;
+        }
+        else if (change < -threshold) {
+            improvements++;
+        }
+        else {
+            continue;
+        }
+        printf("%-36s %10.3f %10.3f %+7.1f%%  %s\n", c.Name().c_str(), base->frame_ms.p50, c.frame_ms.p50, change,
+            change > 0 ? "REGRESSION" : "faster");
+    }
+    printf("%zu cases: %d regressions and %d improvements beyond %.1f%%, %d not in the baseline\n",
+        cases.size(), regressions, improvements, threshold, missing);
+    return regressions;
+}
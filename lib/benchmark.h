@@ -0,0 +1,66 @@
+#pragma once
+#include "profiler.h"
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+//================================
+// Benchmark
+//================================
+
+#define BENCHMARK_FRAMES 20             // timed frames per case unless --frames is given
+#define BENCHMARK_WARMUP 2              // untimed frames before each case
+#define BENCHMARK_SEED 1                // seeds the rotation script
+#define BENCHMARK_THRESHOLD 10.0        // percent slower p50 frame time flagged as a regression
+#define BENCHMARK_MODELS "assets/dfiles"
+
+// Model rotation for a frame of the benchmark script, 0 to 2 pi. A hash of
+// seed and frame, so every build renders the same views in the same order.
+float BenchmarkAngle(Uint32 seed, int frame);
+
+// Paths of the .d models in dir, sorted by name
+std::vector< std::string > BenchmarkModels(const char* dir);
+
+// One model, render type and resolution
+class BenchmarkCase {
+public:
+    std::string model;          // file name within BENCHMARK_MODELS
+    std::string render;         // name accepted by --render
+    int width;
+    int height;
+    int frames;
+    ProfileSummary frame_ms;
+    double triangles_per_s;     // triangles submitted (faces as fans) per second of frame time
+    double fragments_per_s;     // pixels that passed the depth test per second of frame time
+
+public:
+    BenchmarkCase() : width(0), height(0), frames(0), triangles_per_s(0), fragments_per_s(0) {
+    }
+
+    // "model render WIDTHxHEIGHT"
+    std::string Name(void) const;
+};
+
+// Settings the whole run shares, recorded with the results
+class BenchmarkRun {
+public:
+    Uint32 seed;
+    int threads;
+    std::string raster;
+    bool deferred;
+    std::vector< BenchmarkCase > cases;
+
+public:
+    BenchmarkRun() : seed(BENCHMARK_SEED), threads(1), deferred(false) {
+    }
+
+    // JSON, one case per line
+    bool Write(const char* path) const;
+
+    // Read a file written by Write
+    bool Read(const char* path);
+
+    // Print the cases whose p50 frame time changed by more than threshold
+    // percent from baseline and return the number of regressions
+    int Compare(const BenchmarkRun &baseline, double threshold) const;
+};
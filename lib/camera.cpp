@@ -2,6 +2,7 @@
 #include "mat4.h"
 #include "utils.h"
 #include <cmath>
+#include <algorithm>
 
 mat4 Camera::GetViewMatrix()
 {
@@ -38,3 +39,62 @@ mat4 Camera::GetPerspectiveMatrix()
 
     return pers; 
 }
+
+Frustum Camera::GetFrustum()
+{
+    return Frustum(GetPerspectiveMatrix() * GetViewMatrix());
+}
+
+//================================
+// Frustum
+//================================
+
+Frustum::Frustum(const mat4 &m)
+{
+    // Clip space inside is -w <= x <= w, -w <= y <= w and 0 <= z <= w
+    vec4 x(m[0], m[1], m[2], m[3]);
+    vec4 y(m[4], m[5], m[6], m[7]);
+    vec4 z(m[8], m[9], m[10], m[11]);
+    vec4 w(m[12], m[13], m[14], m[15]);
+    planes[0] = w + x;
+    planes[1] = w - x;
+    planes[2] = w + y;
+    planes[3] = w - y;
+    planes[4] = z;
+    planes[5] = w - z;
+    for (vec4 &p : planes) {
+        p = p / sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+    }
+}
+
+FrustumTest Frustum::TestSphere(const vec3 &center, float radius) const
+{
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (const vec4 &p : planes) {
+        float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        if (distance < -radius) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (distance < radius) {
+            result = FRUSTUM_INTERSECTS;
+        }
+    }
+    return result;
+}
+
+FrustumTest Frustum::TestBox(const vec3 &min, const vec3 &max) const
+{
+    FrustumTest result = FRUSTUM_INSIDE;
+    for (const vec4 &p : planes) {
+        // Corners farthest along and against the plane normal
+        vec3 positive(p.x >= 0 ? max.x : min.x, p.y >= 0 ? max.y : min.y, p.z >= 0 ? max.z : min.z);
+        vec3 negative(p.x >= 0 ? min.x : max.x, p.y >= 0 ? min.y : max.y, p.z >= 0 ? min.z : max.z);
+        if (p.x * positive.x + p.y * positive.y + p.z * positive.z + p.w < 0) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (p.x * negative.x + p.y * negative.y + p.z * negative.z + p.w < 0) {
+            result = FRUSTUM_INTERSECTS;
+        }
+    }
+    return result;
+}
@@ -1,8 +1,39 @@
 #pragma once
 #include "vec3.h"
 #include "mat4.h"
+#include "vec4.h"
 #include "constants.h"
 
+//================================
+// Frustum
+//================================
+
+// Result of testing a bounding volume against a Frustum
+enum FrustumTest {
+    FRUSTUM_OUTSIDE,        // entirely outside one plane
+    FRUSTUM_INTERSECTS,     // may cross a plane
+    FRUSTUM_INSIDE,         // entirely inside every plane
+};
+
+// The six planes of a view volume, as (a, b, c, d) with a x + b y + c z + d >= 0
+// inside and (a, b, c) unit length. Planes are taken from the rows of a
+// projection * view (* model) matrix, so they are in the space that matrix
+// transforms from.
+class Frustum {
+public:
+    vec4 planes[6];         // left, right, bottom, top, near, far
+
+public:
+    Frustum() {}
+
+    Frustum(const mat4 &transform);
+
+    FrustumTest TestSphere(const vec3 &center, float radius) const;
+
+    // Axis aligned box from min to max
+    FrustumTest TestBox(const vec3 &min, const vec3 &max) const;
+};
+
 //================================
 // Camera
 //================================
@@ -64,4 +95,7 @@ public:
 
     // Returns perspective matrix (prospective transformation from camera frame)
     mat4 GetPerspectiveMatrix();
+
+    // Returns the view volume in world space
+    Frustum GetFrustum();
 };
@@ -0,0 +1,101 @@
+#include "clip.h"
+#include <algorithm>
+
+// Signed distance to plane, >= 0 inside
+static float ClipDistance(const vec4 &p, int plane) {
+    switch (plane) {
+        case CLIP_LEFT:
+            return p.x + p.w;
+        case CLIP_RIGHT:
+            return p.w - p.x;
+        case CLIP_BOTTOM:
+            return p.y + p.w;
+        case CLIP_TOP:
+            return p.w - p.y;
+        case CLIP_NEAR:
+            return p.z;
+        case CLIP_FAR:
+            return p.w - p.z;
+        case CLIP_GUARD_LEFT:
+            return p.x + CLIP_GUARD_BAND * p.w;
+        case CLIP_GUARD_RIGHT:
+            return CLIP_GUARD_BAND * p.w - p.x;
+        case CLIP_GUARD_BOTTOM:
+            return p.y + CLIP_GUARD_BAND * p.w;
+        case CLIP_GUARD_TOP:
+            return CLIP_GUARD_BAND * p.w - p.y;
+    }
+    return 0.0f;
+}
+
+// Near first, so the other planes only see vertices in front of the camera
+static const int CLIP_ORDER[CLIP_PLANES] = {
+    CLIP_NEAR, CLIP_FAR,
+    CLIP_GUARD_LEFT, CLIP_GUARD_RIGHT, CLIP_GUARD_BOTTOM, CLIP_GUARD_TOP,
+    CLIP_LEFT, CLIP_RIGHT, CLIP_BOTTOM, CLIP_TOP,
+};
+
+static ClipVertex Lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+    ClipVertex v;
+    v.position = a.position + (b.position - a.position) * t;
+    v.vec = a.vec + t * (b.vec - a.vec);
+    v.vert = a.vert + t * (b.vert - a.vert);
+    return v;
+}
+
+bool ClipPolygon(std::vector< ClipVertex > &poly, std::vector< ClipVertex > &scratch, int planes) {
+    for (int p = 0; p < CLIP_PLANES && poly.size() >= 3; p++) {
+        int plane = CLIP_ORDER[p];
+        if (!(planes & plane)) {
+            continue;
+        }
+
+        // Keep inside vertices and add one where each edge crosses the plane
+        scratch.clear();
+        size_t n = poly.size();
+        for (size_t k = 0; k < n; k++) {
+            const ClipVertex &a = poly[k];
+            const ClipVertex &b = poly[(k + 1) % n];
+            float da = ClipDistance(a.position, plane);
+            float db = ClipDistance(b.position, plane);
+            if (da >= 0) {
+                scratch.push_back(a);
+            }
+            if ((da >= 0) != (db >= 0)) {
+                scratch.push_back(Lerp(a, b, da / (da - db)));
+            }
+        }
+        poly.swap(scratch);
+    }
+    return poly.size() >= 3;
+}
+
+bool ClipLine(vec4 &a, vec4 &b, int planes) {
+    // Liang-Barsky: narrow the parameter range to the part inside every plane
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    for (int p = 0; p < CLIP_PLANES; p++) {
+        int plane = CLIP_ORDER[p];
+        if (!(planes & plane)) {
+            continue;
+        }
+        float da = ClipDistance(a, plane);
+        float db = ClipDistance(b, plane);
+        if (da < 0 && db < 0) {
+            return false;
+        }
+        if (da < 0) {
+            t0 = std::max(t0, da / (da - db));
+        }
+        else if (db < 0) {
+            t1 = std::min(t1, da / (da - db));
+        }
+    }
+    if (t0 > t1) {
+        return false;
+    }
+    vec4 d = b - a;
+    b = a + d * t1;
+    a = a + d * t0;
+    return true;
+}
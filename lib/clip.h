@@ -0,0 +1,72 @@
+#pragma once
+#include "vec3.h"
+#include "vec4.h"
+#include <SDL2/SDL.h>
+#include <vector>
+
+//================================
+// Clipping
+//================================
+
+// Half size of the guard band as a multiple of the viewport's. The
+// rasterizers clip to the screen themselves, so polygons that reach off
+// screen but stay inside the guard band are drawn as they are. Only
+// polygons crossing the near or far plane or the guard band are clipped.
+#define CLIP_GUARD_BAND 2.0f
+
+// Outcode bits of a clip space position, set when it is outside the plane.
+// The view volume is -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+enum ClipPlane {
+    CLIP_LEFT = 1 << 0,             // x < -w
+    CLIP_RIGHT = 1 << 1,            // x > w
+    CLIP_BOTTOM = 1 << 2,           // y < -w
+    CLIP_TOP = 1 << 3,              // y > w
+    CLIP_NEAR = 1 << 4,             // z < 0
+    CLIP_FAR = 1 << 5,              // z > w
+    CLIP_GUARD_LEFT = 1 << 6,       // x < -CLIP_GUARD_BAND * w
+    CLIP_GUARD_RIGHT = 1 << 7,      // x > CLIP_GUARD_BAND * w
+    CLIP_GUARD_BOTTOM = 1 << 8,     // y < -CLIP_GUARD_BAND * w
+    CLIP_GUARD_TOP = 1 << 9,        // y > CLIP_GUARD_BAND * w
+    CLIP_PLANES = 10,
+};
+
+// A face with every vertex outside one of these planes is not drawn
+#define CLIP_FRUSTUM (CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP | CLIP_NEAR | CLIP_FAR)
+
+// A face with any vertex outside one of these planes is clipped against them
+#define CLIP_POLYGON (CLIP_NEAR | CLIP_FAR | CLIP_GUARD_LEFT | CLIP_GUARD_RIGHT | CLIP_GUARD_BOTTOM | CLIP_GUARD_TOP)
+
+inline Uint16 ClipOutcode(const vec4 &p) {
+    float g = CLIP_GUARD_BAND * p.w;
+    return (p.x < -p.w) * CLIP_LEFT | (p.x > p.w) * CLIP_RIGHT
+        | (p.y < -p.w) * CLIP_BOTTOM | (p.y > p.w) * CLIP_TOP
+        | (p.z < 0) * CLIP_NEAR | (p.z > p.w) * CLIP_FAR
+        | (p.x < -g) * CLIP_GUARD_LEFT | (p.x > g) * CLIP_GUARD_RIGHT
+        | (p.y < -g) * CLIP_GUARD_BOTTOM | (p.y > g) * CLIP_GUARD_TOP;
+}
+
+// Screen position and depth of a clip space position on a viewport of
+// twice half_width x half_height
+inline void ClipToScreen(const vec4 &h, float half_width, float half_height, float &x, float &y, float &z) {
+    x = half_width * (h.x/h.w) + half_width;
+    y = half_height * (h.y/h.w) + half_height;
+    z = h.z/h.w;
+}
+
+// Polygon vertex before the perspective divide, with the attributes the
+// rasterizers interpolate
+class ClipVertex {
+public:
+    vec4 position;  // clip space
+    vec3 vec;       // norm or intensity
+    vec3 vert;      // vertex position
+};
+
+// Sutherland-Hodgman: clip the convex polygon poly against each plane in
+// planes, in homogeneous space so it works for vertices behind the camera.
+// New vertices interpolate the attributes linearly along the clipped edge.
+// scratch holds the intermediate polygons. Returns false if nothing is left.
+bool ClipPolygon(std::vector< ClipVertex > &poly, std::vector< ClipVertex > &scratch, int planes);
+
+// Clip the segment a b against each plane in planes, false if nothing is left
+bool ClipLine(vec4 &a, vec4 &b, int planes);
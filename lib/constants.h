@@ -12,10 +12,12 @@
 // #define DEBUG 1
 #define ANIMATE 1
 #define ROTATION_SPEED 0.05
+// #define DIRECT_DRAW 1   // draw each pixel with SDL_RenderDrawPoint instead of the framebuffer
 
 //================================
 // Render Style
 //================================
+// Default for --render, every style is compiled in and picked at run time
 // #define RENDER_TYPE WIREFRAME
 // #define RENDER_TYPE FACES 
 // #define RENDER_TYPE DEPTH 
@@ -26,6 +28,29 @@
 // #define RENDER_TYPE ENVIRONMENT
 // #define RENDER_TYPE TEXTURE
 
+//================================
+// Rasterizer
+//================================
+#define RASTER_TYPE SCANLINE        // edge table / active edge table
+// #define RASTER_TYPE HALFSPACE       // SIMD edge functions over triangle bounding boxes
+
+//================================
+// Threads
+//================================
+#define RENDER_THREADS 0            // threads rasterizing screen tiles, 0 for one per core
+#define MAX_RENDER_THREADS 256      // most threads --threads accepts
+
+//================================
+// Shading
+//================================
+#define DEFERRED_SHADING 0          // shade phong, texture and environment through a G-buffer, each pixel once
+
+//================================
+// Mesh Cache
+//================================
+#define MESH_CACHE 1                // cache parsed .d models in a binary file next to them
+#define MESH_CACHE_EXT ".mesh"      // cache path is the model path plus this extension
+
 //================================
 // Material Style
 //================================
@@ -103,6 +128,11 @@ enum RenderType {
     ENVIRONMENT,
 };
 
+enum RasterType {
+    SCANLINE,
+    HALFSPACE,
+};
+
 enum MaterialType {
     METAL,
     PLASTIC,
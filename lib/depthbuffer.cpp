@@ -0,0 +1,108 @@
+#include "depthbuffer.h"
+#include <algorithm>
+
+DepthBuffer::DepthBuffer(int width, int height) {
+    Resize(width, height);
+}
+
+void DepthBuffer::Resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    this->blocks_x = (width + DEPTH_BLOCK - 1) / DEPTH_BLOCK;
+    this->blocks_y = (height + DEPTH_BLOCK - 1) / DEPTH_BLOCK;
+    this->tiles_x = (width + DEPTH_TILE - 1) / DEPTH_TILE;
+    this->tiles_y = (height + DEPTH_TILE - 1) / DEPTH_TILE;
+    this->depth.resize(width * height + DEPTH_PADDING);
+    this->block_max.resize(blocks_x * blocks_y);
+    this->block_dirty.resize(blocks_x * blocks_y);
+    this->tile_max.resize(tiles_x * tiles_y);
+    this->tile_dirty.resize(tiles_x * tiles_y);
+    Clear(1.0);
+}
+
+void DepthBuffer::Clear(float value) {
+    std::fill(depth.begin(), depth.end(), value);
+    std::fill(block_max.begin(), block_max.end(), value);
+    std::fill(block_dirty.begin(), block_dirty.end(), 0);
+    std::fill(tile_max.begin(), tile_max.end(), value);
+    std::fill(tile_dirty.begin(), tile_dirty.end(), 0);
+}
+
+void DepthBuffer::MarkDirty(int x0, int y0, int x1, int y1) {
+    for (int by = y0 >> DEPTH_BLOCK_SHIFT; by <= y1 >> DEPTH_BLOCK_SHIFT; by++) {
+        for (int bx = x0 >> DEPTH_BLOCK_SHIFT; bx <= x1 >> DEPTH_BLOCK_SHIFT; bx++) {
+            block_dirty[by * blocks_x + bx] = 1;
+        }
+    }
+    for (int ty = y0 >> DEPTH_TILE_SHIFT; ty <= y1 >> DEPTH_TILE_SHIFT; ty++) {
+        for (int tx = x0 >> DEPTH_TILE_SHIFT; tx <= x1 >> DEPTH_TILE_SHIFT; tx++) {
+            tile_dirty[ty * tiles_x + tx] = 1;
+        }
+    }
+}
+
+float DepthBuffer::BlockMax(int bx, int by, bool refresh) {
+    int b = by * blocks_x + bx;
+    if (refresh && block_dirty[b]) {
+        int x0 = bx * DEPTH_BLOCK;
+        int y0 = by * DEPTH_BLOCK;
+        int x1 = std::min(x0 + DEPTH_BLOCK, width);
+        int y1 = std::min(y0 + DEPTH_BLOCK, height);
+        float m = depth[y0 * width + x0];
+        for (int y = y0; y < y1; y++) {
+            const float *row = Row(y);
+            for (int x = x0; x < x1; x++) {
+                m = std::max(m, row[x]);
+            }
+        }
+        block_max[b] = m;
+        block_dirty[b] = 0;
+    }
+    return block_max[b];
+}
+
+float DepthBuffer::TileMax(int tx, int ty, bool refresh) {
+    int t = ty * tiles_x + tx;
+    if (refresh && tile_dirty[t]) {
+        const int ratio = DEPTH_TILE / DEPTH_BLOCK;
+        int bx1 = std::min((tx + 1) * ratio, blocks_x);
+        int by1 = std::min((ty + 1) * ratio, blocks_y);
+        float m = BlockMax(tx * ratio, ty * ratio, true);
+        for (int by = ty * ratio; by < by1; by++) {
+            for (int bx = tx * ratio; bx < bx1; bx++) {
+                m = std::max(m, BlockMax(bx, by, true));
+            }
+        }
+        tile_max[t] = m;
+        tile_dirty[t] = 0;
+    }
+    return tile_max[t];
+}
+
+float DepthBuffer::MaxDepth(int x0, int y0, int x1, int y1, bool refresh) {
+    // Whole tiles inside the rectangle use the coarse level, the edges use blocks
+    float m = -1.0e30f;
+    for (int ty = y0 >> DEPTH_TILE_SHIFT; ty <= y1 >> DEPTH_TILE_SHIFT; ty++) {
+        for (int tx = x0 >> DEPTH_TILE_SHIFT; tx <= x1 >> DEPTH_TILE_SHIFT; tx++) {
+            int tile_x0 = tx * DEPTH_TILE;
+            int tile_y0 = ty * DEPTH_TILE;
+            int tile_x1 = std::min(tile_x0 + DEPTH_TILE, width) - 1;
+            int tile_y1 = std::min(tile_y0 + DEPTH_TILE, height) - 1;
+            if (x0 <= tile_x0 && y0 <= tile_y0 && x1 >= tile_x1 && y1 >= tile_y1) {
+                m = std::max(m, TileMax(tx, ty, refresh));
+                continue;
+            }
+
+            int bx0 = std::max(x0, tile_x0) >> DEPTH_BLOCK_SHIFT;
+            int by0 = std::max(y0, tile_y0) >> DEPTH_BLOCK_SHIFT;
+            int bx1 = std::min(x1, tile_x1) >> DEPTH_BLOCK_SHIFT;
+            int by1 = std::min(y1, tile_y1) >> DEPTH_BLOCK_SHIFT;
+            for (int by = by0; by <= by1; by++) {
+                for (int bx = bx0; bx <= bx1; bx++) {
+                    m = std::max(m, BlockMax(bx, by, refresh));
+                }
+            }
+        }
+    }
+    return m;
+}
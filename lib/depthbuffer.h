@@ -0,0 +1,92 @@
+#pragma once
+#include "constants.h"
+#include "utils.h"
+#include <SDL2/SDL.h>
+#include <vector>
+
+//================================
+// DepthBuffer
+//================================
+
+// Pixels per side of a depth block, the finest level of the max depth pyramid
+#define DEPTH_BLOCK_SHIFT 3
+#define DEPTH_BLOCK (1 << DEPTH_BLOCK_SHIFT)
+
+// Pixels per side of a depth tile, the coarse level. Must divide TILE_SIZE
+// so each tile renderer thread owns whole depth tiles.
+#define DEPTH_TILE_SHIFT 6
+#define DEPTH_TILE (1 << DEPTH_TILE_SHIFT)
+
+// Allowance for rounding in interpolated depth, larger than the error
+// accumulated by stepping an edge down the whole screen
+#define DEPTH_MARGIN 1e-4f
+
+// Floats of padding after the last row so SIMD loads may read past the end of a row
+#define DEPTH_PADDING 8
+
+// Spans at least this long are tested against the maxima before drawing
+#define DEPTH_SPAN 32
+
+// Polygons whose bounding box covers at least this many pixels are tested
+// against refreshed maxima before drawing. Refreshing costs more than it
+// saves on small polygons.
+#define DEPTH_POLYGON_AREA 1024
+
+// Row-major depth buffer with a two level max depth pyramid.
+// Block and tile maxima are upper bounds on the depth stored below them:
+// depth only ever decreases between clears, so a stale maximum is still safe.
+// Drawing marks the blocks it touched dirty and their maxima are recomputed
+// by the next query that asks for it. Writers and queries touching the same
+// tile must come from the same thread.
+class DepthBuffer {
+public:
+    int width;
+    int height;
+    int blocks_x, blocks_y;
+    int tiles_x, tiles_y;
+    std::vector< float > depth;         // row-major, plus DEPTH_PADDING
+    std::vector< float > block_max;     // farthest depth in each block
+    std::vector< Uint8 > block_dirty;   // block written since block_max was computed
+    std::vector< float > tile_max;      // farthest depth in each tile
+    std::vector< Uint8 > tile_dirty;    // a block in the tile is dirty
+
+public:
+    DepthBuffer(int width, int height);
+
+    ~DepthBuffer() {}
+
+    // Reallocate for a width x height screen, cleared to 1
+    void Resize(int width, int height);
+
+    void Clear(float value);
+
+    inline float* Row(int y) {
+        return &depth[y * width];
+    }
+
+    inline float Get(int x, int y) {
+        return depth[y * width + x];
+    }
+
+    // Store a depth that passed the depth test, MarkDirty must follow
+    inline void Set(int x, int y, float z) {
+        depth[y * width + x] = z;
+    }
+
+    // Flag the maxima of the inclusive pixel rectangle for recomputing
+    void MarkDirty(int x0, int y0, int x1, int y1);
+
+    // Upper bound on the depth stored in the inclusive pixel rectangle,
+    // recomputing dirty maxima first if refresh is set
+    float MaxDepth(int x0, int y0, int x1, int y1, bool refresh);
+
+    // True if no depth at or behind z_near can pass the depth test in the rectangle
+    inline bool Occluded(int x0, int y0, int x1, int y1, float z_near, bool refresh) {
+        return comparefloats(z_near, MaxDepth(x0, y0, x1, y1, refresh), FLOAT_TOL) != -1;
+    }
+
+private:
+    float BlockMax(int bx, int by, bool refresh);
+
+    float TileMax(int tx, int ty, bool refresh);
+};
@@ -0,0 +1,237 @@
+#include "dfile.h"
+#include "threadpool.h"
+#include <stdio.h>
+#include <string.h>
+#include <charconv>
+#include <string>
+#include <type_traits>
+#include <algorithm>
+
+static_assert(sizeof(vec3) == 3 * sizeof(float), "verts are parsed as packed floats");
+
+//=============================================
+// Tokens
+//=============================================
+
+static inline bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
+
+static inline const char* SkipSpace(const char *p, const char *end) {
+    while (p < end && IsSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Parse the number at p (after any whitespace) and move p past it.
+// The number must be followed by whitespace or the end of the text.
+template <typename T>
+static bool ParseNumber(const char *&p, const char *end, T &value) {
+    const char *s = SkipSpace(p, end);
+    if (s < end && *s == '+') {
+        s++;
+    }
+    std::from_chars_result r = std::from_chars(s, end, value);
+    if (r.ec == std::errc::result_out_of_range && std::is_floating_point< T >::value) {
+        // Denormal or huge values, which fscanf accepted as well
+        value = strtof(std::string(s, r.ptr).c_str(), NULL);
+    }
+    else if (r.ec != std::errc()) {
+        return false;
+    }
+    if (r.ptr < end && !IsSpace(*r.ptr)) {
+        return false;
+    }
+    p = r.ptr;
+    return true;
+}
+
+//=============================================
+// Vertex chunks
+//=============================================
+
+struct DChunk {
+    const char *begin;
+    const char *end;
+    size_t first_token;     // index of the chunk's first token in the vertex block
+    size_t tokens;
+    bool ok;
+};
+
+static size_t CountTokens(const char *p, const char *end) {
+    size_t tokens = 0;
+    bool in_token = false;
+    for (; p < end; p++) {
+        bool space = IsSpace(*p);
+        tokens += !space && !in_token;
+        in_token = !space;
+    }
+    return tokens;
+}
+
+// Parse the floats of chunk into values, stopping at count floats in total.
+// Chunks never split a token since they start and end on whitespace.
+static void ParseChunk(DChunk &chunk, float *values, size_t count) {
+    const char *p = chunk.begin;
+    chunk.ok = true;
+    for (size_t t = chunk.first_token; t < count && t < chunk.first_token + chunk.tokens; t++) {
+        if (!ParseNumber(p, chunk.end, values[t])) {
+            chunk.ok = false;
+            return;
+        }
+    }
+}
+
+// Parse count floats starting at p into values, split over up to threads
+// chunks. On success p points past the last float.
+static bool ParseFloats(const char *&p, const char *end, float *values, size_t count, int threads) {
+    int chunks = std::max(1, std::min(threads, (int)((end - p) / DFILE_CHUNK_SIZE)));
+    if (chunks == 1) {
+        for (size_t t = 0; t < count; t++) {
+            if (!ParseNumber(p, end, values[t])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The end of the vertex block isn't known until tokens are counted,
+    // so the chunks cover the rest of the file and tokens past count are skipped
+    std::vector< DChunk > chunk(chunks);
+    size_t step = (end - p) / chunks;
+    const char *begin = p;
+    for (int c = 0; c < chunks; c++) {
+        const char *stop = end;
+        if (c + 1 < chunks) {
+            stop = p + (c + 1) * step;
+            while (stop < end && !IsSpace(*stop)) {
+                stop++;
+            }
+        }
+        chunk[c].begin = begin;
+        chunk[c].end = std::max(begin, stop);
+        begin = chunk[c].end;
+    }
+
+    ThreadPool pool(chunks);
+    auto count_task = [&](int c, int thread) {
+        chunk[c].tokens = CountTokens(chunk[c].begin, chunk[c].end);
+    };
+    pool.Run(chunks, count_task);
+
+    size_t first = 0;
+    int last = -1;
+    for (int c = 0; c < chunks; c++) {
+        chunk[c].first_token = first;
+        first += chunk[c].tokens;
+        if (last < 0 && first >= count) {
+            last = c;
+        }
+    }
+    if (last < 0) {
+        return false;
+    }
+
+    chunks = last + 1;
+    auto parse_task = [&](int c, int thread) {
+        ParseChunk(chunk[c], values, count);
+    };
+    pool.Run(chunks, parse_task);
+
+    // Resume after the last vertex token
+    p = chunk[last].begin;
+    for (size_t t = chunk[last].first_token; t < count; t++) {
+        p = SkipSpace(p, end);
+        while (p < end && !IsSpace(*p)) {
+            p++;
+        }
+    }
+    for (int c = 0; c < chunks; c++) {
+        if (!chunk[c].ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//=============================================
+// DFile
+//=============================================
+
+bool ParseDText(const char* path, const char* text, size_t size, std::vector< vec3 > &verts,
+                std::vector< int > &face_offsets, std::vector< int > &face_indices, int threads) {
+    const char *p = text;
+    const char *end = text + size;
+
+    // Header
+    int num_verts = 0;
+    int num_faces = 0;
+    p = SkipSpace(p, end);
+    if (end - p < 4 || strncmp(p, "data", 4) != 0) {
+        printf("Error loading model %s: missing data header\n", path);
+        return false;
+    }
+    p += 4;
+    if (!ParseNumber(p, end, num_verts) || !ParseNumber(p, end, num_faces) || num_verts < 0 || num_faces < 0) {
+        printf("Error loading model %s: bad vertex or face count\n", path);
+        return false;
+    }
+
+    // Vertex block
+    verts.resize(num_verts);
+    if (!ParseFloats(p, end, (float*)verts.data(), 3 * (size_t)num_verts, threads)) {
+        printf("Error loading model %s: truncated or invalid vertex data\n", path);
+        return false;
+    }
+
+    // Faces go straight into the flat index buffer
+    face_offsets.resize(num_faces + 1);
+    face_offsets[0] = 0;
+    face_indices.clear();
+    face_indices.reserve(4 * (size_t)num_faces);
+    for (int i = 0; i < num_faces; i++) {
+        int sides = 0;
+        if (!ParseNumber(p, end, sides)) {
+            printf("Error loading model %s: truncated or invalid face %d\n", path, i);
+            return false;
+        }
+        if (sides < 3) {
+            printf("Error loading model %s: face %d has %d sides\n", path, i, sides);
+            return false;
+        }
+        for (int k = 0; k < sides; k++) {
+            int index = 0;
+            if (!ParseNumber(p, end, index)) {
+                printf("Error loading model %s: truncated or invalid face %d\n", path, i);
+                return false;
+            }
+            if (index < 1 || index > num_verts) {
+                printf("Error loading model %s: face %d uses vertex %d of %d\n", path, i, index, num_verts);
+                return false;
+            }
+            face_indices.push_back(index - 1);
+        }
+        face_offsets[i + 1] = face_indices.size();
+    }
+    return true;
+}
+
+bool ParseDFile(const char* path, std::vector< vec3 > &verts, std::vector< int > &face_offsets,
+                std::vector< int > &face_indices, int threads) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    std::vector< char > text(std::max(size, 0L));
+    bool ok = size >= 0 && fread(text.data(), 1, text.size(), fp) == text.size();
+    fclose(fp);
+    if (!ok) {
+        printf("Error reading model %s\n", path);
+        return false;
+    }
+    return ParseDText(path, text.data(), text.size(), verts, face_offsets, face_indices, threads);
+}
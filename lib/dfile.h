@@ -0,0 +1,24 @@
+#pragma once
+#include "vec3.h"
+#include <stddef.h>
+#include <vector>
+
+//================================
+// DFile
+//================================
+
+// Smallest share of a file given to each parser thread. Files under twice
+// this are parsed on the calling thread alone.
+#define DFILE_CHUNK_SIZE (64 * 1024)
+
+// Parse an ASCII .d model: "data <verts> <faces>", the vertex positions,
+// then for each face its number of sides followed by 1-based vertex indices.
+// Faces are returned as a flat index buffer with zero based indices.
+// The vertex block is split into chunks parsed on up to threads threads.
+// Prints an error and returns false if the file is truncated or malformed.
+bool ParseDFile(const char* path, std::vector< vec3 > &verts, std::vector< int > &face_offsets,
+                std::vector< int > &face_indices, int threads);
+
+// Parse a .d file already in memory, see ParseDFile
+bool ParseDText(const char* path, const char* text, size_t size, std::vector< vec3 > &verts,
+                std::vector< int > &face_offsets, std::vector< int > &face_indices, int threads);
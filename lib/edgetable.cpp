@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include <cmath>
+#include <algorithm>
 
 //=============================================
 // Edge 
@@ -12,7 +13,8 @@ Edge::Edge(int y_max, float x_min, float inv_m, float z_min, float del_z) {
     this->inv_m= inv_m;
     this->z_min = z_min;
     this->del_z = del_z;
-    this->next = nullptr;
+    this->x_int = 0;
+    this->next = -1;
 }
 
 Edge::Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec) {
@@ -23,7 +25,8 @@ Edge::Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 v
     this->del_z = del_z;
     this->vec_min = vec_min;
     this->del_vec = del_vec;
-    this->next = nullptr;
+    this->x_int = 0;
+    this->next = -1;
 }
 
 Edge::Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec, vec3 vert_min, vec3 del_vert) {
@@ -36,40 +39,74 @@ Edge::Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 v
     this->del_vec = del_vec;
     this->vert_min = vert_min;
     this->del_vert = del_vert;
-    this->next = nullptr;
-
+    this->x_int = 0;
+    this->next = -1;
 }
 //=============================================
 // Edge Table
 //=============================================
 
-int EdgeTable::InsertEdge(int scanline, Edge* edge) {
-    std::map<int,Edge*>::iterator head;
+EdgeTable::EdgeTable(int height) {
+    Resize(height);
+}
+
+void EdgeTable::Resize(int height) {
+    this->buckets.assign(height, -1);
+    this->y_lo = height;
+    this->y_hi = -1;
+    this->count = 0;
+    this->edges.clear();
+}
+
+void EdgeTable::Clear(void) {
+    // Only reset the buckets that were used
+    for (int y = this->y_lo; y <= this->y_hi; y++) {
+        this->buckets[y] = -1;
+    }
+    this->y_lo = this->buckets.size();
+    this->y_hi = -1;
+    this->count = 0;
+    this->edges.clear();
+}
+
+int EdgeTable::InsertEdge(int scanline, const Edge &edge) {
+    assert(scanline >= 0);
+    if (scanline >= (int)this->buckets.size()) {
+        return 0;
+    }
 
-    head = this->scanlines.find(scanline);
-    if (head == this->scanlines.end()) {
+    int index = this->edges.size();
+    this->edges.push_back(edge);
+    Edge* e = &this->edges[index];
+    e->next = -1;
+
+    this->y_lo = std::min(this->y_lo, scanline);
+    this->y_hi = std::max(this->y_hi, scanline);
+    this->count++;
+
+    int head = this->buckets[scanline];
+    if (head == -1) {
         // Scanline is empty, insert edge to head
-        this->scanlines[scanline] = edge;
+        this->buckets[scanline] = index;
     }
     else {
         // Scanline contains edges, add edge in sorted order
-        Edge* cur = head->second;
+        Edge* cur = &this->edges[head];
 
-        if (edge->x_min < cur->x_min || (edge->x_min == cur->x_min && edge->inv_m < cur->inv_m)) {
+        if (e->x_min < cur->x_min || (e->x_min == cur->x_min && e->inv_m < cur->inv_m)) {
             // Insert edge at head (if smaller than head)
-            this->scanlines[scanline] = edge;
-            this->scanlines[scanline]->next = cur;
+            e->next = head;
+            this->buckets[scanline] = index;
         }
         else {
             // Insert edge in sorted order
-            while(cur->next != nullptr && cur->next->x_min < edge->x_min) {
+            while(cur->next != -1 && this->edges[cur->next].x_min < e->x_min) {
                 // iterate to edge we want to insert after
-                cur = cur->next;
+                cur = &this->edges[cur->next];
             }
             // insert edge after cur
-            Edge* next = cur->next;
-            cur->next = edge;
-            edge->next = next;
+            e->next = cur->next;
+            cur->next = index;
         }
     }
 
@@ -78,50 +115,46 @@ int EdgeTable::InsertEdge(int scanline, Edge* edge) {
 
 Edge* EdgeTable::RemoveEdge(int scanline) {
     // Remove the head from the scanline
-    std::map<int,Edge*>::iterator iter;
-
-    iter = this->scanlines.find(scanline);
-    if (iter == this->scanlines.end()) {
+    if (scanline < 0 || scanline >= (int)this->buckets.size()) {
         return nullptr;
     }
-    else {
-        Edge* head = iter->second;
-        if (head->next == nullptr) {
-            scanlines.erase(scanline);
-        }
-        else {
-            this->scanlines[scanline] = head->next;
-        }
-        head->next = nullptr;
-        return head;
+
+    int head = this->buckets[scanline];
+    if (head == -1) {
+        return nullptr;
     }
+
+    Edge* e = &this->edges[head];
+    this->buckets[scanline] = e->next;
+    e->next = -1;
+    this->count--;
+    return e;
 }
 
-EdgeTable::~EdgeTable() {
-    // Destructor, deletes all edges
-    std::map<int,Edge*>::iterator it;
-    for (it=this->scanlines.begin(); it != this->scanlines.end(); it++) {
-        Edge* cur = it->second;
-        while(cur != nullptr) {
-            Edge* next = cur->next;
-            delete cur;
-            cur = next;
+int EdgeTable::FirstScanline(void) {
+    for (int y = this->y_lo; y <= this->y_hi; y++) {
+        if (this->buckets[y] != -1) {
+            return y;
         }
     }
+    return 0;
 }
 
 bool EdgeTable::IsEmpty() {
-    return this->scanlines.empty();
+    return this->count == 0;
 }
 
 void EdgeTable::PrintEdgeTable() {
-    std::map<int,Edge*>::iterator it;
-    for (it=this->scanlines.begin(); it != this->scanlines.end(); it++) {
-        printf("Scanline %d\t: ", it->first);
-        Edge* cur = it->second;
-        while(cur != nullptr) {
-            printf("(y_max=%d x_min=%f 1/m=%f z_min=%f del_z=%f) ",cur->y_max, cur->x_min, cur->inv_m, cur->z_min, cur->del_z);
-            cur = cur->next;
+    for (int y = this->y_lo; y <= this->y_hi; y++) {
+        if (this->buckets[y] == -1) {
+            continue;
+        }
+        printf("Scanline %d\t: ", y);
+        int cur = this->buckets[y];
+        while(cur != -1) {
+            Edge* e = &this->edges[cur];
+            printf("(y_max=%d x_min=%f 1/m=%f z_min=%f del_z=%f) ",e->y_max, e->x_min, e->inv_m, e->z_min, e->del_z);
+            cur = e->next;
         }
         printf("\n");
     }
@@ -131,67 +164,32 @@ void EdgeTable::PrintEdgeTable() {
 // Active Edge Table
 //=============================================
 
-ActiveEdgeTable::ActiveEdgeTable() {
-    this->aet = new std::multimap<int,Edge*>();
-}
-
-ActiveEdgeTable::~ActiveEdgeTable() {
-    // Destructor, deletes all edges
-    if (this->aet != nullptr) {
-        std::multimap<int,Edge*>::iterator it;
-        for (it=(*this->aet).begin(); it != (*this->aet).end(); it++) {
-            Edge* cur = it->second;
-            delete cur;
-            (*this->aet).erase(it->first);
-        }
-        delete this->aet;
-    }
+void ActiveEdgeTable::Clear(void) {
+    this->edges.clear();
 }
 
 int ActiveEdgeTable::InsertEdge(int x_int, Edge* edge) {
-    assert(this->aet != nullptr);
-    (*this->aet).insert(std::pair<int,Edge*>(x_int, edge));
+    edge->x_int = x_int;
+
+    // Shift larger edges right, keeping edges with equal x_int in insertion order
+    this->edges.push_back(edge);
+    int i = this->edges.size() - 1;
+    while (i > 0 && this->edges[i - 1]->x_int > x_int) {
+        this->edges[i] = this->edges[i - 1];
+        i--;
+    }
+    this->edges[i] = edge;
     return 0;
 }
 
 bool ActiveEdgeTable::IsEmpty() {
-    assert(this->aet != nullptr);
-    return (*this->aet).empty();
-}
-
-void ActiveEdgeTable::UpdateEdges(int scanline) {
-    assert(this->aet != nullptr);
-
-    std::multimap<int,Edge*> *new_aet = new std::multimap<int,Edge*>();
-    // Only save edges whose y_max > scanline
-    std::multimap<int,Edge*>::iterator it;
-    for (it=(*this->aet).begin(); it != (*this->aet).end(); it++) {
-        Edge* cur = it->second;
-        // Update edge and move it to new table
-        if (cur->y_max > scanline + 1) {
-            cur->x_min += cur->inv_m;
-            cur->z_min += cur->del_z;
-            cur->vec_min = cur->vec_min + cur->del_vec;
-            cur->vert_min = cur->vert_min + cur->del_vert;
-            int x_int = (int)round(cur->x_min);
-            (*new_aet).insert(std::pair<int,Edge*>(x_int, cur));
-        }
-        else {
-            delete cur;
-        }
-    }
-
-    // Switch old AET to new AET
-    delete this->aet;
-    this->aet = new_aet;
+    return this->edges.empty();
 }
 
 void ActiveEdgeTable::PrintActiveEdgeTable() {
-    std::multimap<int,Edge*>::iterator it;
-    assert(this->aet != nullptr);
     printf("AET: \n");
-    for (it=(*this->aet).begin(); it != (*this->aet).end(); it++) {
-        Edge* cur = it->second;
-        printf("[%d](y_max=%d x_min=%f 1/m=%f z_min=%f del_z=%f)\n",it->first, cur->y_max, cur->x_min, cur->inv_m, cur->z_min, cur->del_z);
+    for (size_t i = 0; i < this->edges.size(); i++) {
+        Edge* cur = this->edges[i];
+        printf("[%d](y_max=%d x_min=%f 1/m=%f z_min=%f del_z=%f)\n", cur->x_int, cur->y_max, cur->x_min, cur->inv_m, cur->z_min, cur->del_z);
     }
-}
\ No newline at end of file
+}
@@ -1,11 +1,14 @@
 #pragma once
 #include "vec3.h"
-#include <map>
+#include "constants.h"
+#include <vector>
+#include <cmath>
 
 //================================
 // Edge
 //================================
 
+// Plain data, edges are stored by value in the EdgeTable arena
 class Edge {
 public:
     int y_max;      // scanline of high edge
@@ -13,18 +16,19 @@ public:
     float inv_m;    // 1/m slope
     float z_min;    // z value at low edge
     float del_z;    // rate of change from z_min
-    Edge *next;     // next edge in EdgeTable bucket
+    int x_int;      // x_min rounded, sort key in ActiveEdgeTable
+    int next;       // index of next edge in EdgeTable bucket, -1 at end
     vec3 vec_min;   // norm or intensity at low edge
     vec3 del_vec;   // rate of change in vec norm or intensity
     vec3 vert_min;   // vertex position at low edge
     vec3 del_vert;   // rate of change in vertex position
 
 public:
-    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z); 
+    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z);
 
-    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec); 
+    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec);
 
-    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec, vec3 vert_min, vec3 del_vert); 
+    Edge(int y_max, float x_min, float inv_m, float z_min, float del_z, vec3 vec_min, vec3 del_vec, vec3 vert_min, vec3 del_vert);
 
     ~Edge() {}
 };
@@ -33,19 +37,39 @@ public:
 // EdgeTable
 //================================
 
+// Edges are bucketed by the scanline of their low end. The arena and bucket
+// array keep their capacity between Clear calls, so steady state rendering
+// does not allocate.
 class EdgeTable {
 public:
-    std::map<int,Edge*> scanlines;
+    std::vector< Edge > edges;      // arena of edges for the current polygon
+    std::vector< int > buckets;     // index of first edge on each scanline, -1 if empty
+    int y_lo;                       // lowest scanline with a bucket in use
+    int y_hi;                       // highest scanline with a bucket in use
+    int count;                      // number of edges still in buckets
 
 public:
-    EdgeTable() {}
+    EdgeTable(int height = SCREEN_HEIGHT);
 
-    ~EdgeTable();
+    ~EdgeTable() {}
 
-    int InsertEdge(int scanline, Edge* edge);
+    // Bucket every scanline of a screen height pixels tall, emptying the table
+    void Resize(int height);
 
+    // Empty all buckets and the arena
+    void Clear(void);
+
+    // Copy edge into the arena, sorted by x_min within its scanline.
+    // Edges starting below the screen are never drawn and are dropped.
+    int InsertEdge(int scanline, const Edge &edge);
+
+    // Remove and return the first edge on scanline, nullptr if none.
+    // Pointers stay valid until the next InsertEdge or Clear.
     Edge* RemoveEdge(int scanline);
 
+    // Lowest scanline holding an edge
+    int FirstScanline(void);
+
     bool IsEmpty();
 
     void PrintEdgeTable();
@@ -57,18 +81,51 @@ public:
 
 class ActiveEdgeTable {
 public:
-    std::multimap<int,Edge*> *aet;
+    std::vector< Edge* > edges;     // active edges sorted by x_int
 
 public:
-    ActiveEdgeTable();
+    ActiveEdgeTable() {}
 
-    ~ActiveEdgeTable();
+    ~ActiveEdgeTable() {}
 
+    void Clear(void);
+
+    // Insertion sort edge into place, after any edges with the same x_int
     int InsertEdge(int x_int, Edge* edge);
 
     bool IsEmpty();
 
-    void UpdateEdges(int delta);
+    // Drop edges that end at scanline and step the rest to the next one.
+    // Only the first ATTRIBS interpolated floats (vec, then vert) are stepped.
+    template <int ATTRIBS>
+    void UpdateEdges(int scanline) {
+        // Only keep edges whose y_max > scanline + 1, stepping them in place
+        size_t count = 0;
+        for (size_t i = 0; i < this->edges.size(); i++) {
+            Edge* cur = this->edges[i];
+            if (cur->y_max > scanline + 1) {
+                cur->x_min += cur->inv_m;
+                cur->z_min += cur->del_z;
+                if (ATTRIBS >= 3) {
+                    cur->vec_min = cur->vec_min + cur->del_vec;
+                }
+                if (ATTRIBS >= 6) {
+                    cur->vert_min = cur->vert_min + cur->del_vert;
+                }
+                cur->x_int = (int)round(cur->x_min);
+
+                // Insertion sort, edges stay nearly sorted between scanlines
+                size_t j = count;
+                while (j > 0 && this->edges[j - 1]->x_int > cur->x_int) {
+                    this->edges[j] = this->edges[j - 1];
+                    j--;
+                }
+                this->edges[j] = cur;
+                count++;
+            }
+        }
+        this->edges.resize(count);
+    }
 
     void PrintActiveEdgeTable();
-};
\ No newline at end of file
+};
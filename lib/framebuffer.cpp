@@ -0,0 +1,106 @@
+#include "framebuffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+Framebuffer::Framebuffer(int width, int height) {
+    this->width = width;
+    this->height = height;
+    this->color.resize(width * height);
+    this->renderer = NULL;
+    this->texture = NULL;
+}
+
+Framebuffer::~Framebuffer() {
+    Free();
+}
+
+void Framebuffer::Resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    this->color.assign(width * height, 0);
+}
+
+bool Framebuffer::Init(SDL_Renderer *renderer) {
+    Free();
+    this->renderer = renderer;
+
+    #ifndef DIRECT_DRAW
+    this->texture = SDL_CreateTexture(renderer, FRAMEBUFFER_FORMAT, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (this->texture == NULL) {
+        printf("Framebuffer texture could not be created. SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    #endif
+
+    return true;
+}
+
+void Framebuffer::Free(void) {
+    if (this->texture != NULL) {
+        SDL_DestroyTexture(this->texture);
+        this->texture = NULL;
+    }
+    this->renderer = NULL;
+}
+
+void Framebuffer::Clear(Uint8 r, Uint8 g, Uint8 b) {
+    #ifdef DIRECT_DRAW
+    SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
+    SDL_RenderClear(renderer);
+    #else
+    Uint32 c = 0xFF000000 | ((Uint32)b << 16) | ((Uint32)g << 8) | (Uint32)r;
+    std::fill(color.begin(), color.end(), c);
+    #endif
+}
+
+void Framebuffer::DrawLine(int x0, int y0, int x1, int y1, Uint8 r, Uint8 g, Uint8 b) {
+    // Bresenham's line algorithm, skipping points that fall off screen
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    while (true) {
+        if (x0 >= 0 && x0 < width && y0 >= 0 && y0 < height) {
+            SetPixel(x0, y0, r, g, b);
+        }
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void Framebuffer::Present(void) {
+    #ifndef DIRECT_DRAW
+    SDL_UpdateTexture(texture, NULL, color.data(), width * sizeof(Uint32));
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+    #endif
+    SDL_RenderPresent(renderer);
+}
+
+bool Framebuffer::SavePPM(const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+
+    bool ok = fprintf(fp, "P6\n%d %d\n255\n", width, height) > 0;
+    for (int i = 0; ok && i < width * height; i++) {
+        Uint8 rgb[3] = { (Uint8)(color[i] & 0xFF), (Uint8)((color[i] >> 8) & 0xFF), (Uint8)((color[i] >> 16) & 0xFF) };
+        ok = fwrite(rgb, 1, 3, fp) == 3;
+    }
+
+    ok = (fclose(fp) == 0) && ok;
+    return ok;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "constants.h"
+#include <SDL2/SDL.h>
+#include <vector>
+
+//================================
+// Framebuffer
+//================================
+
+// Pixels are packed as 0xAABBGGRR so the bytes in memory are R, G, B, A
+#define FRAMEBUFFER_FORMAT SDL_PIXELFORMAT_ABGR8888
+
+class Framebuffer {
+public:
+    int width;
+    int height;
+    std::vector< Uint32 > color;    // RGBA8 color buffer, row-major
+    SDL_Renderer *renderer;         // Renderer to present to
+    SDL_Texture *texture;           // Streaming texture uploaded once per frame
+
+public:
+    Framebuffer(int width, int height);
+
+    ~Framebuffer();
+
+    // Reallocate the color buffer for a width x height screen, before Init
+    void Resize(int width, int height);
+
+    // Create the streaming texture used by Present
+    bool Init(SDL_Renderer *renderer);
+
+    void Free(void);
+
+    void Clear(Uint8 r, Uint8 g, Uint8 b);
+
+    // Write a single pixel, (x, y) must be on screen
+    inline void SetPixel(int x, int y, Uint8 r, Uint8 g, Uint8 b) {
+        #ifdef DIRECT_DRAW
+        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
+        SDL_RenderDrawPoint(renderer, x, y);
+        #else
+        color[y * width + x] = 0xFF000000 | ((Uint32)b << 16) | ((Uint32)g << 8) | (Uint32)r;
+        #endif
+    }
+
+    // Draw a line clipped to the screen
+    void DrawLine(int x0, int y0, int x1, int y1, Uint8 r, Uint8 g, Uint8 b);
+
+    // Upload the color buffer and show it
+    void Present(void);
+
+    // Write the color buffer to a binary PPM file
+    bool SavePPM(const char* path);
+};
@@ -0,0 +1,50 @@
+#include "gbuffer.h"
+#include <algorithm>
+
+//================================
+// GBuffer
+//================================
+
+GBuffer::GBuffer(int width, int height) {
+    this->width = width;
+    this->height = height;
+    faces.assign((size_t)width * height, GBUFFER_EMPTY);
+    instances.assign((size_t)width * height, 0);
+    Reset();
+}
+
+void GBuffer::Reserve(int width, int height, int attribs) {
+    if (width != this->width || height != this->height) {
+        this->width = width;
+        this->height = height;
+        faces.assign((size_t)width * height, GBUFFER_EMPTY);
+        instances.assign((size_t)width * height, 0);
+        vecs.clear();
+        verts.clear();
+        dverts.clear();
+        Reset();
+    }
+    size_t size = (size_t)width * height;
+    if (attribs >= 3 && vecs.size() != size) {
+        vecs.resize(size);
+    }
+    if (attribs >= 6 && verts.size() != size) {
+        verts.resize(size);
+        dverts.resize(size);
+    }
+}
+
+void GBuffer::Extend(int x0, int y0, int x1, int y1) {
+    this->x0 = std::min(this->x0, x0);
+    this->y0 = std::min(this->y0, y0);
+    this->x1 = std::max(this->x1, x1);
+    this->y1 = std::max(this->y1, y1);
+}
+
+void GBuffer::Reset(void) {
+    draws.clear();
+    x0 = width;
+    y0 = height;
+    x1 = -1;
+    y1 = -1;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "vec3.h"
+#include "mat4.h"
+#include <vector>
+
+class Model;
+class Material;
+
+//================================
+// GBuffer
+//================================
+
+// Marks a pixel no face has been drawn to since it was last shaded
+#define GBUFFER_EMPTY -1
+
+// Per draw inputs of a shading policy, kept until the frame's shading pass
+class GBufferDraw {
+public:
+    Model *model;
+    Material *material;
+    mat4 model_matrix;
+    vec3 view_direction;    // toward the camera from the model center
+    vec3 light_direction;   // toward the light from the model center
+
+public:
+    GBufferDraw(Model *model, Material *material, const mat4 &model_matrix, const vec3 &view_direction, const vec3 &light_direction)
+        : model(model), material(material), model_matrix(model_matrix), view_direction(view_direction), light_direction(light_direction) {
+    }
+};
+
+// Per pixel inputs of a shading policy, written by the geometry pass of
+// every deferred draw in a frame and read back by one shading pass after
+// the last draw. Depth lives in the depth buffer. Each pixel records the
+// draw that stored it, so instances and models sharing the screen are
+// shaded together. The shading pass resets every pixel it shades to
+// GBUFFER_EMPTY and forgets the draws, so the buffer never needs clearing.
+// Structure of arrays, only the attributes a policy interpolates are touched.
+class GBuffer {
+public:
+    int width;
+    int height;
+    std::vector< int > faces;       // face drawn at each pixel, GBUFFER_EMPTY for none
+    std::vector< int > instances;   // index into draws of the draw that stored each pixel
+    std::vector< vec3 > vecs;       // interpolated vec (ATTRIBS >= 3)
+    std::vector< vec3 > verts;      // interpolated vert (ATTRIBS >= 6)
+    std::vector< vec3 > dverts;     // change in vert per pixel along the span (ATTRIBS >= 6)
+    std::vector< GBufferDraw > draws;   // draws stored since the last shading pass
+    int x0, y0;                     // bounds of the pixels stored since the last shading pass,
+    int x1, y1;                     // empty when x1 < x0
+
+public:
+    GBuffer(int width, int height);
+
+    ~GBuffer() {}
+
+    // Cover a width x height screen and allocate the attribute planes for
+    // ATTRIBS interpolated floats. Changing the size empties the buffer.
+    void Reserve(int width, int height, int attribs);
+
+    // Start storing a draw, returns its index for Set
+    int AddDraw(const GBufferDraw &draw) {
+        draws.push_back(draw);
+        return draws.size() - 1;
+    }
+
+    // Grow the bounds to cover the pixels x0..x1, y0..y1
+    void Extend(int x0, int y0, int x1, int y1);
+
+    // Forget the draws and bounds, after the shading pass has emptied every pixel
+    void Reset(void);
+
+    template <int ATTRIBS>
+    inline void Set(int x, int y, int face, int instance, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        int p = y * width + x;
+        faces[p] = face;
+        instances[p] = instance;
+        if (ATTRIBS >= 3) {
+            vecs[p] = vec;
+        }
+        if (ATTRIBS >= 6) {
+            verts[p] = vert;
+            dverts[p] = dvert;
+        }
+    }
+};
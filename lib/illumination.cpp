@@ -2,10 +2,7 @@
 
 #include "vec3.h"
 #include "illumination.h"
-#include "utils.h"
 #include <stdio.h>
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <assert.h>
 #include <cmath>
 
@@ -29,7 +26,7 @@ Material::Material() {
     this->k_diffuse = 0.4;
     this->k_specular = 0.3;
     this->shininess = 20;
-    this->texture = NULL;
+    InitSpecular();
 }
 
 Material::Material(vec3 color, float k_ambient, float k_diffuse, float k_specular, int shininess) {
@@ -38,58 +35,52 @@ Material::Material(vec3 color, float k_ambient, float k_diffuse, float k_specula
     this->k_diffuse = k_diffuse;
     this->k_specular = k_specular;
     this->shininess = shininess;
-    this->texture = NULL;
+    InitSpecular();
 }
 
-Material::~Material() {
-    SDL_FreeSurface(this->texture);
-    this->texture = NULL;
+void Material::InitSpecular(void) {
+    specular_cutoff = shininess > 0 ? pow(SPECULAR_EPSILON, 1.0 / shininess) : 0.0f;
+
+    // Error bound against pow, sampled densely over [0, 1]
+    specular_error = 0;
+    const int samples = 1 << 14;
+    for (int i = 0; i <= samples; i++) {
+        float x = (float)i / samples;
+        float error = fabs(Specular(x) - pow((double)x, shininess));
+        if (error > specular_error) {
+            specular_error = error;
+        }
+    }
 }
 
 bool Material::LoadTexture(const char* path) {
-    // Load image at path
-    this->texture = IMG_Load(path);
-    if (this->texture == NULL) {
-        printf("Unable to load image %s. SDL_image Error: %s\n", path, IMG_GetError());
-        return false;
-    }
-
-    return true;
+    return this->texture.Load(path);
 }
 
-vec3 Material::GetTexture(vec3 sphere) {
+vec3 Material::GetTexture(vec3 sphere, float angle) {
     // Return a vec3 corresponding to rgb intensity 0 to 1
-
-    // Map normal into latitude longitude
-
-    // Get a longitude wrapping eastward from x-, in the range 0-1.
-    float longitude = 0.5 - atan2(sphere.z, sphere.x) / (2.0 * M_PI);
-    // Get a latitude wrapping northward from y-, in the range 0-1.
-    float latitude = 0.5 + asin(sphere.y) / M_PI;
-
-    // Scale to integer between texture width and height
-    int x = (int)round((this->texture->w - 1) * longitude);
-    int y = (int)round((this->texture->h - 1) * latitude);
-
-    if (!(x >= 0 && x < this->texture->w)) {
-        printf("x: %d\n",x);
+    if (TEXTURE_FILTER == TEXTURE_NEAREST) {
+        return TexelColor(this->texture.FetchEquirect(sphere));
     }
-    if (!(y >= 0 && y < this->texture->h)) {
-        printf("y: %d\n",y);
+    float u, v;
+    EquirectCoords(sphere, u, v);
+    if (TEXTURE_FILTER == TEXTURE_BILINEAR) {
+        return this->texture.SampleBilinear(0, u, v);
     }
-    assert(x >= 0 && x < this->texture->w);
-    assert(y >= 0 && y < this->texture->h);
-    
-    Uint8 _r, _g, _b, _a;
-    GetPixel(this->texture, x, y, &_r, &_g, &_b, &_a);
+    return this->texture.SampleTrilinear(u, v, this->texture.EquirectLod(angle));
+}
 
-    // scale between 0 and 1
-    float r = (float)_r / 256.0;
-    float g = (float)_g / 256.0;
-    float b = (float)_b / 256.0;
-    // printf("color at (x: %d,y: %d): (r: %f\t g: %f\t b: %f\t)\n", x, y, r, g, b);
+bool Material::LoadEnvironment(const char* path) {
+    Texture equirect;
+    if (!equirect.Load(path)) {
+        return false;
+    }
+    this->environment.Build(equirect);
+    return true;
+}
 
-    return vec3(r, g, b);
+vec3 Material::GetEnvironment(vec3 direction) {
+    return TexelColor(this->environment.Fetch(direction));
 }
 
 vec3 Material::PhongIllumination(vec3 surface_color, vec3 view, vec3 normal, vec3 light_direction, Light light) {
@@ -106,7 +97,7 @@ vec3 Material::PhongIllumination(vec3 surface_color, vec3 view, vec3 normal, vec
 
     vec3 i_specular = vec3();
     if (V.dot(R) > 0)
-        i_specular = this->k_specular * pow(V.dot(R),this->shininess) * light.color;
+        i_specular = this->k_specular * Specular(V.dot(R)) * light.color;
     
     vec3 i_total = i_ambient + i_diffuse + i_specular;
     return i_total;
@@ -1,6 +1,31 @@
 #pragma once
 #include "vec3.h"
-#include <SDL2/SDL.h>
+#include "texture.h"
+
+//================================
+// Specular power
+//================================
+
+// Specular terms below this are returned as 0, well under one 8 bit step.
+// This also keeps high powers of small values out of slow denormal floats.
+#define SPECULAR_EPSILON 1e-6f
+
+// x^n by squaring, for any integer n
+inline float PowInt(float x, int n) {
+    unsigned int e = n < 0 ? -(unsigned int)n : n;
+    float result = 1.0f;
+    float base = x;
+    while (e != 0) {
+        if (e & 1) {
+            result *= base;
+        }
+        e >>= 1;
+        if (e != 0) {
+            base *= base;
+        }
+    }
+    return n < 0 ? 1.0f / result : result;
+}
 
 class Light {
 public:
@@ -17,6 +42,10 @@ public:
     vec3 LightDirection(vec3 point);
 };
 
+//================================
+// Material
+//================================
+
 class Material {
 public:
     vec3 color;
@@ -24,20 +53,42 @@ public:
     float k_diffuse;
     float k_specular;
     int shininess;
-    SDL_Surface *texture;
+    float specular_cutoff;  // x^shininess < SPECULAR_EPSILON below this
+    float specular_error;   // largest difference from pow over [0, 1]
+    Texture texture;        // equirectangular, for TEXTURE
+    CubeMap environment;    // for ENVIRONMENT
 
 public:
     Material();
 
     Material(vec3 color, float k_ambient, float k_diffuse, float k_specular, int shininess);
 
-    ~Material();
+    ~Material() {}
 
     bool LoadTexture(const char* path);
 
-    vec3 GetTexture(vec3 normal);
+    // Color of the texture in direction sphere (a unit vector), filtered
+    // by TEXTURE_FILTER for a pixel covering angle radians
+    vec3 GetTexture(vec3 sphere, float angle = 0);
+
+    // Load an equirectangular image and convert it to a cube map
+    bool LoadEnvironment(const char* path);
+
+    vec3 GetEnvironment(vec3 direction);
+
+    // x^shininess for x in [0, 1]
+    inline float Specular(float x) const {
+        if (x < specular_cutoff) {
+            return 0.0f;
+        }
+        return PowInt(x, shininess);
+    }
 
     vec3 PhongIllumination(vec3 surface_color, vec3 view, vec3 normal, vec3 light_direction, Light light);
 
     vec3 CartoonIllumination(vec3 normal, vec3 light_direction);
+
+private:
+    // Set the specular cutoff and error bound for shininess
+    void InitSpecular(void);
 };
@@ -1,16 +1,29 @@
 #pragma once
+#include <assert.h>
+#include <type_traits>
 
+// Row major 4x4 matrix, header only like vec3 and vec4
 class mat4 
 {
 public:
 	float mat[16];
 
 public:
-	mat4(float diagonal);
-	mat4(float e0, float e1, float e2, float e3, 
-         float e4, float e5, float e6, float e7, 
-         float e8, float e9, float e10, float e11, 
-         float e12, float e13, float e14, float e15);
+	constexpr mat4(float diagonal) 
+		: mat{diagonal, 0, 0, 0,
+		      0, diagonal, 0, 0,
+		      0, 0, diagonal, 0,
+		      0, 0, 0, diagonal} 
+	{
+	}
+
+	constexpr mat4(float e0, float e1, float e2, float e3, 
+	               float e4, float e5, float e6, float e7, 
+	               float e8, float e9, float e10, float e11, 
+	               float e12, float e13, float e14, float e15) 
+		: mat{e0, e1, e2, e3, e4, e5, e6, e7, e8, e9, e10, e11, e12, e13, e14, e15} 
+	{
+	}
 
     // Operator overloading:
     // https://www.programiz.com/cpp-programming/operator-overloading
@@ -19,12 +32,39 @@ public:
     /*
      * Overload * operator to compute matrix multiplication
      */
-	mat4 operator *(const mat4& m) const;
-	float operator [](int index) const;
+	constexpr mat4 operator *(const mat4& m) const 
+	{
+		mat4 result(0);
+		for (int i = 0; i < 4; i++)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				// Row major order (matches math notations)
+				float sum = 0;
+				for (int k = 0; k < 4; k++)
+				{
+					sum += mat[i * 4 + k] * m.mat[j + k * 4];
+				}
+				result.mat[i * 4 + j] = sum;
+			}
+		}
+		return result;
+	}
+
+	constexpr float operator [](int index) const 
+	{
+		assert(index >= 0 && index < 16);
+		return mat[index];
+	}
 
     // & is a reference to mat index for assignment
     // i.e. mat[2] = 12.3;
     // https://isocpp.org/wiki/faq/references#returning-refs
-	float& operator [](int index);
+	constexpr float& operator [](int index) 
+	{
+		assert(index >= 0 && index < 16);
+		return mat[index];
+	}
 };
 
+static_assert(std::is_trivially_copyable< mat4 >::value, "mat4 is copied as raw floats");
@@ -0,0 +1,333 @@
+#include "mesh.h"
+#include "vec4.h"
+#include "vec3.h"
+#include "utils.h"
+#include "dfile.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+//=============================================
+// Load Mesh
+//=============================================
+
+void Mesh::Free(void) 
+{
+    verts.clear();
+    face_offsets.clear();
+    face_indices.clear();
+    model_face_normals.clear();
+    model_vert_normals.clear();
+    vert_face_offsets.clear();
+    vert_faces.clear();
+    face_colors.clear();
+    bound_min = vec3(0, 0, 0);
+    bound_max = vec3(0, 0, 0);
+    bound_center = vec3(0, 0, 0);
+    bound_radius = 0;
+}
+
+bool Mesh::LoadModel(const char* path, bool use_cache)
+{
+    if (!path) {
+        printf("Error loading model.\n");
+        return false;
+    }
+
+    size_t length = strlen(path);
+    size_t ext_length = strlen(MESH_CACHE_EXT);
+    if (length >= ext_length && strcmp(path + length - ext_length, MESH_CACHE_EXT) == 0) {
+        return LoadMesh(path, -1, 0);
+    }
+
+    // The cache is only used while it matches the source file
+    std::string cache_path = std::string(path) + MESH_CACHE_EXT;
+    Sint64 mtime = 0;
+    Uint64 size = 0;
+    use_cache = use_cache && FileStamp(path, mtime, size);
+    if (use_cache && LoadMesh(cache_path.c_str(), mtime, size)) {
+        return true;
+    }
+
+    if (!LoadD(path)) {
+        return false;
+    }
+    if (use_cache) {
+        SaveMesh(cache_path.c_str(), mtime, size);
+    }
+    return true;
+}
+
+bool Mesh::LoadD(const char* path) 
+{
+    Free();
+
+    // Threads only help files large enough to split into several chunks
+    int threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    if (!ParseDFile(path, verts, face_offsets, face_indices, threads)) {
+        Free();
+        return false;
+    }
+    size_t numFaces = NumFaces();
+    model_face_normals.resize(numFaces);
+    face_colors.resize(numFaces);
+
+    // calculate face normals
+    for (size_t i = 0; i < numFaces; i++) {
+        // get the first 3 verts of a face
+        const int *indices = FaceIndices(i);
+        vec3 v0 = verts[indices[0]];
+        vec3 v1 = verts[indices[1]];
+        vec3 v2 = verts[indices[2]];
+        vec3 edge1 = v0 - v1;
+        vec3 edge2 = v2 - v1;
+        vec3 normal = edge2.cross(edge1);
+        model_face_normals[i] = normal.normalize();
+
+        // Set face to random color
+        face_colors[i] = vec3(rand() % 256, rand() % 256, rand() % 256);
+    }
+
+    BuildAdjacency();
+
+    ResizeModel();
+    CalcBound(bound_min, bound_max);
+    CalcSphere();
+
+    return true;
+}
+
+bool Mesh::LoadMesh(const char* path, Sint64 mtime, Uint64 size)
+{
+    MeshFile mesh;
+    if (!mesh.Open(path)) {
+        return false;
+    }
+    const MeshHeader &h = *mesh.header;
+    if (mtime >= 0 && (h.source_mtime != mtime || h.source_size != size)) {
+        return false;
+    }
+
+    Free();
+    verts.assign(mesh.positions, mesh.positions + h.num_verts);
+    face_offsets.assign(mesh.face_offsets, mesh.face_offsets + h.num_faces + 1);
+    face_indices.assign(mesh.indices, mesh.indices + h.num_indices);
+    model_face_normals.assign(mesh.face_normals, mesh.face_normals + h.num_faces);
+    model_vert_normals.assign(mesh.vert_normals, mesh.vert_normals + h.num_verts);
+    vert_face_offsets.assign(mesh.vert_face_offsets, mesh.vert_face_offsets + h.num_verts + 1);
+    vert_faces.assign(mesh.vert_faces, mesh.vert_faces + h.num_indices);
+    bound_min = vec3(h.bound_min[0], h.bound_min[1], h.bound_min[2]);
+    bound_max = vec3(h.bound_max[0], h.bound_max[1], h.bound_max[2]);
+    CalcSphere();
+
+    // Same sequence of random colors as parsing the source
+    face_colors.resize(h.num_faces);
+    for (size_t i = 0; i < face_colors.size(); i++) {
+        face_colors[i] = vec3(rand() % 256, rand() % 256, rand() % 256);
+    }
+    return true;
+}
+
+bool Mesh::SaveMesh(const char* path, Sint64 mtime, Uint64 size) const
+{
+    MeshHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MESH_MAGIC, 4);
+    h.version = MESH_VERSION;
+    h.num_verts = verts.size();
+    h.num_faces = NumFaces();
+    h.num_indices = face_indices.size();
+    h.source_mtime = mtime;
+    h.source_size = size;
+    for (int k = 0; k < 3; k++) {
+        h.bound_min[k] = bound_min[k];
+        h.bound_max[k] = bound_max[k];
+    }
+
+    // Write to a temporary file and rename it, so readers never map a partial mesh.
+    // The pid keeps processes caching the same model from writing the same temporary.
+    std::string temp_path = std::string(path) + "." + std::to_string(getpid()) + ".tmp";
+    FILE* fp = fopen(temp_path.c_str(), "wb");
+    if (!fp) {
+        printf("Error writing mesh %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+    ok = ok && fwrite(verts.data(), sizeof(vec3), verts.size(), fp) == verts.size();
+    ok = ok && fwrite(face_offsets.data(), sizeof(int), face_offsets.size(), fp) == face_offsets.size();
+    ok = ok && fwrite(face_indices.data(), sizeof(int), face_indices.size(), fp) == face_indices.size();
+    ok = ok && fwrite(model_face_normals.data(), sizeof(vec3), model_face_normals.size(), fp) == model_face_normals.size();
+    ok = ok && fwrite(model_vert_normals.data(), sizeof(vec3), model_vert_normals.size(), fp) == model_vert_normals.size();
+    ok = ok && fwrite(vert_face_offsets.data(), sizeof(int), vert_face_offsets.size(), fp) == vert_face_offsets.size();
+    ok = ok && fwrite(vert_faces.data(), sizeof(int), vert_faces.size(), fp) == vert_faces.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), path) != 0) {
+        printf("Error writing mesh %s\n", path);
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+void Mesh::BuildAdjacency(void)
+{
+    // Count faces per vertex
+    vert_face_offsets.assign(verts.size() + 1, 0);
+    for (size_t k = 0; k < face_indices.size(); k++) {
+        vert_face_offsets[face_indices[k] + 1]++;
+    }
+
+    // Prefix sum into offsets
+    for (size_t i = 0; i < verts.size(); i++) {
+        vert_face_offsets[i + 1] += vert_face_offsets[i];
+    }
+
+    // Scatter face indices into each vertex's range
+    std::vector< int > fill(vert_face_offsets.begin(), vert_face_offsets.end() - 1);
+    vert_faces.resize(vert_face_offsets[verts.size()]);
+    for (int i = 0; i < NumFaces(); i++) {
+        for (int k = face_offsets[i]; k < face_offsets[i + 1]; k++) {
+            vert_faces[fill[face_indices[k]]++] = i;
+        }
+    }
+
+    // Average adjacent face normals
+    // Note: model_face_normals point the opposite way to the normals used for shading
+    model_vert_normals.resize(verts.size());
+    for (size_t i = 0; i < verts.size(); i++) {
+        vec3 normal_sum(0, 0, 0);
+        for (int j = vert_face_offsets[i]; j < vert_face_offsets[i + 1]; j++) {
+            normal_sum -= model_face_normals[vert_faces[j]];
+        }
+        model_vert_normals[i] = normal_sum.normalize();
+    }
+}
+
+//=============================================
+// Resize Model
+//=============================================
+// scale the model into the range of [ -0.9, 0.9 ]
+void Mesh::ResizeModel(void) 
+{
+    // bound
+    vec3 min, max;
+    if (!CalcBound(min, max)) {
+        return;
+    }
+
+    // max side
+    vec3 size = max - min;
+
+    float r = size.x;
+    if (size.y > r) {
+        r = size.y;
+    }
+    if (size.z > r) {
+        r = size.z;
+    }
+
+    if (r < 1e-6f) {
+        r = 0;
+    }
+    else {
+        r = 1.0 / r;
+    }
+
+    // scale
+    for (unsigned int i = 0; i < verts.size(); i++) {
+        // [0, 1]
+        verts[i] = (verts[i] - min) * r;
+
+        // [-1, 1]
+        verts[i] = verts[i] * 2.0 - vec3(1.0, 1.0, 1.0);
+
+        // [-0.9, 0.9]
+        verts[i] *= 0.9;
+    }
+}
+
+bool Mesh::CalcBound(vec3& min, vec3& max) const
+{
+    if (verts.size() <= 0) {
+        return false;
+    }
+
+    min = verts[0];
+    max = verts[0];
+
+    for (unsigned int i = 1; i < verts.size(); i++) {
+        vec3 v = verts[i];
+
+        if (v.x < min.x) {
+            min.x = v.x;
+        }
+        else if (v.x > max.x) {
+            max.x = v.x;
+        }
+
+        if (v.y < min.y) {
+            min.y = v.y;
+        }
+        else if (v.y > max.y) {
+            max.y = v.y;
+        }
+
+        if (v.z < min.z) {
+            min.z = v.z;
+        }
+        else if (v.z > max.z) {
+            max.z = v.z;
+        }
+    }
+
+    return true;
+}
+
+void Mesh::CalcSphere(void)
+{
+    bound_center = 0.5 * (bound_min + bound_max);
+    float radius_squared = 0;
+    for (const vec3 &v : verts) {
+        vec3 d = v - bound_center;
+        radius_squared = std::max(radius_squared, d.dot(d));
+    }
+    bound_radius = sqrt(radius_squared);
+}
+
+FrustumTest Mesh::TestFrustum(const mat4 &model_matrix, const Frustum &frustum) const
+{
+    // Sphere: the center moves with the model, the radius grows with its largest axis scale
+    const mat4 &m = model_matrix;
+    vec4 center = m * vec4(bound_center, 1.0);
+    float scale = 0;
+    for (int j = 0; j < 3; j++) {
+        scale = std::max(scale, m[j] * m[j] + m[4 + j] * m[4 + j] + m[8 + j] * m[8 + j]);
+    }
+    FrustumTest result = frustum.TestSphere(vec3(center.x, center.y, center.z), bound_radius * sqrt(scale));
+    if (result != FRUSTUM_INTERSECTS) {
+        return result;
+    }
+
+    // Box: world axis aligned box around the moved one, usually tighter at the frustum corners
+    vec3 min, max;
+    WorldBounds(model_matrix, min, max);
+    return frustum.TestBox(min, max);
+}
+
+void Mesh::WorldBounds(const mat4 &model_matrix, vec3 &min, vec3 &max) const
+{
+    // Each world axis extends by the absolute projections of the box's half sizes onto it
+    const mat4 &m = model_matrix;
+    vec3 center = 0.5 * (bound_min + bound_max);
+    vec3 half = 0.5 * (bound_max - bound_min);
+    vec3 world_center, extent;
+    for (int i = 0; i < 3; i++) {
+        world_center[i] = m[4 * i] * center.x + m[4 * i + 1] * center.y + m[4 * i + 2] * center.z + m[4 * i + 3];
+        extent[i] = fabs(m[4 * i]) * half.x + fabs(m[4 * i + 1]) * half.y + fabs(m[4 * i + 2]) * half.z;
+    }
+    min = world_center - extent;
+    max = world_center + extent;
+}
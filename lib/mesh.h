@@ -0,0 +1,92 @@
+#pragma once
+#include "mat4.h"
+#include "vec3.h"
+#include "camera.h"
+#include "constants.h"
+#include "meshfile.h"
+#include <SDL2/SDL.h>
+#include <vector>
+
+//================================
+// Mesh
+//================================
+// Geometry of a model, loaded once and shared by every Instance drawing it.
+// Nothing changes it after loading, so it is read concurrently and costs
+// the same however many instances there are.
+class Mesh {
+public:
+    std::vector< vec3 > verts;
+    std::vector< vec3 > model_face_normals;
+    std::vector< vec3 > model_vert_normals;   // average of adjacent face normals (object space)
+    std::vector< int > vert_face_offsets;     // CSR offsets into vert_faces, size verts + 1
+    std::vector< int > vert_faces;            // faces adjacent to each vertex
+    std::vector< vec3 > face_colors;
+    std::vector< int > face_offsets;          // CSR offsets into face_indices, size faces + 1
+    std::vector< int > face_indices;          // vertex indices of every face
+    vec3 bound_min;                           // bounds of verts after ResizeModel
+    vec3 bound_max;
+    vec3 bound_center;                        // sphere around verts, centered on the bounds
+    float bound_radius;
+
+public:
+    Mesh() : bound_radius(0) {
+    }
+
+    ~Mesh() {
+    }
+
+    int NumFaces(void) const {
+        return face_offsets.empty() ? 0 : face_offsets.size() - 1;
+    }
+
+    int FaceSize(int i) const {
+        return face_offsets[i + 1] - face_offsets[i];
+    }
+
+    // Triangles the faces split into as fans
+    int NumTriangles(void) const {
+        return face_indices.size() - 2 * NumFaces();
+    }
+
+    const int* FaceIndices(int i) const {
+        return &face_indices[face_offsets[i]];
+    }
+
+    //=============================================
+    // Load Mesh
+    //=============================================
+    void Free(void);
+
+    // Load a .d model, through its binary cache if use_cache is set.
+    // Paths ending in MESH_CACHE_EXT are loaded as binary meshes directly.
+    bool LoadModel(const char* path, bool use_cache = MESH_CACHE);
+
+    // Parse an ASCII .d model
+    bool LoadD(const char* path);
+
+    // Load a binary mesh, rejecting it unless it was built from a source with
+    // this mtime and size (mtime < 0 accepts any source)
+    bool LoadMesh(const char* path, Sint64 mtime, Uint64 size);
+
+    // Write the loaded model as a binary mesh built from a source with this mtime and size
+    bool SaveMesh(const char* path, Sint64 mtime, Uint64 size) const;
+
+    // Build vertex to face adjacency and vertex normals from faces
+    void BuildAdjacency(void);
+
+    //=============================================
+    // scale the model into the range of [ -0.9, 0.9 ]
+    void ResizeModel(void);
+
+    bool CalcBound(vec3& min, vec3& max) const;
+
+    // Set the bounding sphere from bound_min, bound_max and the verts
+    void CalcSphere(void);
+
+    // Test the bounding sphere, then the box, moved by model_matrix against
+    // a world space frustum
+    FrustumTest TestFrustum(const mat4 &model_matrix, const Frustum &frustum) const;
+
+    // World axis aligned box around the bounds moved by model_matrix
+    void WorldBounds(const mat4 &model_matrix, vec3 &min, vec3 &max) const;
+};
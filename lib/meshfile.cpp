@@ -0,0 +1,123 @@
+#include "meshfile.h"
+#include <string.h>
+#include <limits.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//=============================================
+// MeshFile
+//=============================================
+
+MeshFile::MeshFile() {
+    data = NULL;
+    size = 0;
+    header = NULL;
+}
+
+MeshFile::~MeshFile() {
+    Close();
+}
+
+size_t MeshFile::FileSize(Uint32 num_verts, Uint32 num_faces, Uint32 num_indices) {
+    size_t floats = 3 * (size_t)num_verts + 3 * (size_t)num_faces + 3 * (size_t)num_verts;
+    size_t ints = ((size_t)num_faces + 1) + num_indices + ((size_t)num_verts + 1) + num_indices;
+    return sizeof(MeshHeader) + floats * sizeof(float) + ints * sizeof(int);
+}
+
+bool MeshFile::Open(const char* path) {
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MeshHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    data = map;
+    size = st.st_size;
+
+    const MeshHeader *h = (const MeshHeader*)data;
+    if (memcmp(h->magic, MESH_MAGIC, 4) != 0 || h->version != MESH_VERSION ||
+        size != FileSize(h->num_verts, h->num_faces, h->num_indices)) {
+        printf("Ignoring invalid mesh file %s\n", path);
+        Close();
+        return false;
+    }
+    header = h;
+
+    const char *p = (const char*)data + sizeof(MeshHeader);
+    positions = (const vec3*)p;             p += h->num_verts * sizeof(vec3);
+    face_offsets = (const int*)p;           p += (h->num_faces + 1) * sizeof(int);
+    indices = (const int*)p;                p += h->num_indices * sizeof(int);
+    face_normals = (const vec3*)p;          p += h->num_faces * sizeof(vec3);
+    vert_normals = (const vec3*)p;          p += h->num_verts * sizeof(vec3);
+    vert_face_offsets = (const int*)p;      p += (h->num_verts + 1) * sizeof(int);
+    vert_faces = (const int*)p;
+
+    // Everything the renderer indexes through must stay in bounds
+    if (!CheckArrays()) {
+        printf("Ignoring invalid mesh file %s\n", path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool MeshFile::CheckArrays(void) const {
+    const MeshHeader *h = header;
+    if (h->num_verts > INT_MAX || h->num_faces > INT_MAX || h->num_indices > INT_MAX) {
+        return false;
+    }
+
+    // The CSR arrays start at zero, never decrease and end where the index arrays do
+    if (face_offsets[0] != 0 || face_offsets[h->num_faces] != (int)h->num_indices ||
+        vert_face_offsets[0] != 0 || vert_face_offsets[h->num_verts] != (int)h->num_indices) {
+        return false;
+    }
+    for (Uint32 i = 0; i < h->num_faces; i++) {
+        if (face_offsets[i + 1] - face_offsets[i] < 3) {
+            return false;
+        }
+    }
+    for (Uint32 i = 0; i < h->num_verts; i++) {
+        if (vert_face_offsets[i + 1] < vert_face_offsets[i]) {
+            return false;
+        }
+    }
+    for (Uint32 k = 0; k < h->num_indices; k++) {
+        if ((Uint32)indices[k] >= h->num_verts || (Uint32)vert_faces[k] >= h->num_faces) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshFile::Close(void) {
+    if (data) {
+        munmap(data, size);
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+}
+
+bool FileStamp(const char* path, Sint64 &mtime, Uint64 &size) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return false;
+    }
+    mtime = (Sint64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    size = st.st_size;
+    return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "vec3.h"
+#include <SDL2/SDL.h>
+#include <stddef.h>
+
+//================================
+// MeshFile
+//================================
+
+#define MESH_MAGIC "LRPM"
+#define MESH_VERSION 1
+
+// Binary mesh layout, native byte order. The header is followed by these
+// arrays in order, each starting on a 4 byte boundary:
+//   positions           float[3 * num_verts]    verts after ResizeModel
+//   face_offsets        int[num_faces + 1]      CSR offsets into indices
+//   indices             int[num_indices]        zero based vertex indices
+//   face_normals        float[3 * num_faces]
+//   vert_normals        float[3 * num_verts]
+//   vert_face_offsets   int[num_verts + 1]      CSR offsets into vert_faces
+//   vert_faces          int[num_indices]        faces adjacent to each vertex
+struct MeshHeader {
+    char magic[4];
+    Uint32 version;
+    Uint32 num_verts;
+    Uint32 num_faces;
+    Uint32 num_indices;
+    Uint32 reserved;
+    Sint64 source_mtime;    // modification time of the .d file the cache was built from
+    Uint64 source_size;     // size of that .d file in bytes
+    float bound_min[3];
+    float bound_max[3];
+};
+
+static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 arrays are stored as packed floats");
+
+// Read-only memory mapping of a binary mesh. The arrays point into the
+// mapping and stay valid until Close.
+class MeshFile {
+public:
+    void *data;
+    size_t size;
+    const MeshHeader *header;
+    const vec3 *positions;
+    const int *face_offsets;
+    const int *indices;
+    const vec3 *face_normals;
+    const vec3 *vert_normals;
+    const int *vert_face_offsets;
+    const int *vert_faces;
+
+public:
+    MeshFile();
+
+    ~MeshFile();
+
+    // Map path and check the header and array sizes against the file size,
+    // then CheckArrays
+    bool Open(const char* path);
+
+    void Close(void);
+
+    // Every face has at least 3 sides, offsets never decrease, vertex indices
+    // are below num_verts and adjacent faces below num_faces
+    bool CheckArrays(void) const;
+
+    // Bytes needed for a mesh with the given counts, header included
+    static size_t FileSize(Uint32 num_verts, Uint32 num_faces, Uint32 num_indices);
+};
+
+// Modification time and size of path, false if it can't be read
+bool FileStamp(const char* path, Sint64 &mtime, Uint64 &size);
@@ -5,134 +5,100 @@
 #include "constants.h"
 #include "illumination.h"
 #include "edgetable.h"
+#include "rasterizer.h"
+#include "clip.h"
+#include "tiles.h"
+#include "shaders.h"
+#include "transform.h"
+#include "profiler.h"
+#include "scene.h"
 #include <assert.h>
+#include <algorithm>
 
 //=============================================
-// Load Model
+// Vertex Stage
 //=============================================
 
-void Model::Free(void) 
+void Model::ProcessVerts(mat4 &model_matrix, mat4 &perspective_transform, bool calc_normals, int width, int height)
 {
-    verts.clear();
-    faces.clear();
-    model_face_normals.clear();
-    face_colors.clear();
-}
-
-bool Model::LoadModel(const char* path) 
-{
-    if (!path) {
-        printf("Error loading model.\n");
-        return false;
-    }
-
-    Free();
-
-    // open file
-    FILE* fp = fopen(path, "r");
-    if (!fp) {
-        return false;
-    }
+    // Scale normalized coordinates [-1, 1] to device coordinates [width, height]
+    float half_width = width / 2.0;
+    float half_height = height / 2.0;
 
-    unsigned int numVerts = 0;
-    unsigned int numFaces = 0;
-    // num of vertices and indices
-    fscanf(fp, "data%d%d", &numVerts, &numFaces);
-
-    // alloc vertex and index buffer
-    verts.resize(numVerts);
-    faces.resize(numFaces);
-    model_face_normals.resize(numFaces);
-    face_colors.resize(numFaces);
-
-    // read vertices
-    for (unsigned int i = 0; i < numVerts; i++) {
-        fscanf(fp, "%f%f%f", &verts[i].x, &verts[i].y, &verts[i].z);
+    const std::vector< vec3 > &verts = mesh->verts;
+    screen_verts.Resize(verts.size());
+    TransformPoints(perspective_transform, verts.data(), screen_verts.clip.data(), verts.size());
+    for (size_t i = 0; i < verts.size(); i++) {
+        const vec4 &h = screen_verts.clip[i];
+        ClipToScreen(h, half_width, half_height, screen_verts.x[i], screen_verts.y[i], screen_verts.z[i]);
+        screen_verts.inv_w[i] = 1.0/h.w;
+        screen_verts.outcodes[i] = ClipOutcode(h);
     }
+    TransformPoints(model_matrix, verts.data(), screen_verts.world.data(), verts.size());
 
-
-    // read indices
-    for (unsigned int i = 0; i < numFaces; i++) {
-        int numSides = 0;
-        fscanf(fp, "%i", &numSides);
-        faces[i].indices.resize(numSides);
-
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-            fscanf(fp, "%i", &faces[i].indices[k]);
-            faces[i].indices[k] -= 1;
+    if (calc_normals) {
+        // Model matrix only scales uniformly, so it can transform normals directly
+        screen_verts.normals.resize(verts.size());
+        TransformVectors(model_matrix, mesh->model_vert_normals.data(), screen_verts.normals.data(), verts.size());
+        for (size_t i = 0; i < verts.size(); i++) {
+            screen_verts.normals[i].normalize();
         }
     }
-    
-    // calculate face normals
-    for (size_t i = 0; i < numFaces; i++) {
-        // get the first 3 verts of a face
-        vec3 v0 = verts[faces[i].indices[0]];
-        vec3 v1 = verts[faces[i].indices[1]];
-        vec3 v2 = verts[faces[i].indices[2]];
-        vec3 edge1 = v0 - v1;
-        vec3 edge2 = v2 - v1;
-        vec3 normal = edge2.cross(edge1);
-        model_face_normals[i] = normal.normalize();
-
-        // Set face to random color
-        face_colors[i] = vec3(rand() % 256, rand() % 256, rand() % 256);
-    }
-
-    // close file
-    fclose(fp);
-
-    ResizeModel();
-
-    return true;
 }
 
 //=============================================
 // Render Model
 //=============================================
 
-void Model::DrawEdges(Camera &camera, SDL_Renderer *renderer) {
+void Model::DrawEdges(Camera &camera, Light &light, const Instance &instance, Framebuffer &framebuffer, DepthBuffer &depth) {
     // Apply transformation matrices to get from
     // Model -> World -> Screen 
 
     // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
+    mat4 model_matrix = instance.ModelMatrix();
     mat4 view_matrix = camera.GetViewMatrix();
     mat4 perspective_matrix = camera.GetPerspectiveMatrix();
     mat4 perspective_transform = perspective_matrix * view_matrix * model_matrix;
 
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
+    // Transform verts to screen space
+    ProcessVerts(model_matrix, perspective_transform, false, depth.width, depth.height);
 
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
+    CullFaces(model_matrix, camera);
 
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
+    float half_width = depth.width / 2.0;
+    float half_height = depth.height / 2.0;
+    const std::vector< vec3 > &face_colors = mesh->face_colors;
 
-            // Get perspective transform of edge
-            int p0 = faces[i].indices[k];
-            int p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-
-            vec4 h0 = perspective_transform * vec4(verts[p0], 1.0);
-            vec4 h1 = perspective_transform * vec4(verts[p1], 1.0);
-            vec3 v0 = vec3(h0.x/h0.w, h0.y/h0.w, h0.z/h0.w);
-            vec3 v1 = vec3(h1.x/h1.w, h1.y/h1.w, h1.z/h1.w);
+    // For each face in model
+    for (size_t j = 0; j < visible_faces.size(); j++) {
+        int i = visible_faces[j];
+        const int *indices = FaceIndices(i);
+        int sides = FaceSize(i);
 
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
+        // For each edge in face 
+        for (int k = 0; k < sides; k++) {
 
-            float x0 = half_width * v0.x + half_width;
-            float x1 = half_width * v1.x + half_width;
-            float y0 = half_height * v0.y + half_height;
-            float y1 = half_height * v1.y + half_height;
+            // Get perspective transform of edge
+            int p0 = indices[k];
+            int p1 = indices[(k + 1) % sides];
+
+            float x0 = screen_verts.x[p0];
+            float x1 = screen_verts.x[p1];
+            float y0 = screen_verts.y[p0];
+            float y1 = screen_verts.y[p1];
+
+            // Edges crossing the near or far plane or the guard band are clipped
+            int outside = screen_verts.outcodes[p0] | screen_verts.outcodes[p1];
+            if (outside & CLIP_POLYGON) {
+                vec4 a = screen_verts.clip[p0];
+                vec4 b = screen_verts.clip[p1];
+                if (!ClipLine(a, b, outside & CLIP_POLYGON)) {
+                    continue;
+                }
+                float z;
+                ClipToScreen(a, half_width, half_height, x0, y0, z);
+                ClipToScreen(b, half_width, half_height, x1, y1, z);
+            }
 
             // Round to closest int
             int ix0 = (int)round(x0);
@@ -140,1302 +106,441 @@ void Model::DrawEdges(Camera &camera, SDL_Renderer *renderer) {
             int iy0 = (int)round(y0);
             int iy1 = (int)round(y1);
 
-            SDL_SetRenderDrawColor(renderer, (Uint8)face_colors[i].x, (Uint8)face_colors[i].y, (Uint8)face_colors[i].z, 0xFF);
-            SDL_RenderDrawLine(renderer, ix0, iy0, ix1, iy1);
+            framebuffer.DrawLine(ix0, iy0, ix1, iy1, (Uint8)face_colors[i].x, (Uint8)face_colors[i].y, (Uint8)face_colors[i].z);
         }
     }
 }
 
-void Model::DrawFaces(Camera &camera, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT], bool render_depth) {
-    // Apply transformation matrices to get from
-    // Model -> World -> Screen 
-
-    // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
-    mat4 view_matrix = camera.GetViewMatrix();
-    mat4 perspective_matrix = camera.GetPerspectiveMatrix();
-    mat4 perspective_transform = perspective_matrix * view_matrix * model_matrix;
-    
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
-
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
-
-        // Use constant random color
-        SDL_SetRenderDrawColor(renderer, (Uint8)face_colors[i].x, (Uint8)face_colors[i].y, (Uint8)face_colors[i].z, 0xFF);
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int p0 = faces[i].indices[k];
-            int p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 h0 = perspective_transform * vec4(verts[p0], 1.0);
-            vec4 h1 = perspective_transform * vec4(verts[p1], 1.0);
-            vec3 v0 = vec3(h0.x/h0.w, h0.y/h0.w, h0.z/h0.w);
-            vec3 v1 = vec3(h1.x/h1.w, h1.y/h1.w, h1.z/h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * v0.x + half_width;
-            float x1 = half_width * v1.x + half_width;
-            float y0 = half_height * v0.y + half_height;
-            float y1 = half_height * v1.y + half_height;
-            float z0 = v0.z;
-            float z1 = v1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                // Assume convex polygon - don't shorten edges
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z);
-                et.InsertEdge(y_min,e);
-            }
-        }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-
-                        // Draw depth map
-                        if (render_depth) {
-                            Uint8 c = (Uint8)round(255 * ((z - 0.95) / 0.05)); 
-                            SDL_SetRenderDrawColor(renderer, c, c, c, 0xFF);
-                        }
-
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                }
-            }
+void Model::CullFaces(mat4 &model_matrix, Camera &camera) {
+    visible_faces.clear();
 
-            // Update edges
-            aet.UpdateEdges(y);
-        }
+    // Forget last frame's clipped polygons
+    if ((int)face_clip.size() != NumFaces()) {
+        face_clip.assign(NumFaces(), -1);
     }
-}
-
-void Model::DrawFlat(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]) {
-    // Apply transformation matrices to get from
-    // Model -> World -> Screen 
-
-    // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
-    mat4 view_matrix = camera.GetViewMatrix();
-    mat4 perspective_matrix = camera.GetPerspectiveMatrix();
-    mat4 model_view_matrix = view_matrix * model_matrix;
-    mat4 perspective_transform = perspective_matrix * model_view_matrix;
+    for (int i : clipped_faces) {
+        face_clip[i] = -1;
+    }
+    clipped_faces.clear();
+    const Uint16 *outcodes = screen_verts.outcodes.data();
 
-    // Calculate viewing and lighting direction (assume both are infinitely far away)
-    vec4 _center = model_matrix * vec4(0.0, 0.0, 0.0, 1.0);
-    vec3 center = vec3(_center.x, _center.y, _center.z);
-    vec3 view_direction = (camera.position - center).normalize();
-    vec3 light_direction = light.LightDirection(center);
+    // Face normals are directions, so an instance's translation must not move them
+    cull_normals.resize(NumFaces());
+    TransformVectors(model_matrix, mesh->model_face_normals.data(), cull_normals.data(), NumFaces());
 
     // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
+    for (int i = 0; i < NumFaces(); i++) {
+        // Trivially reject faces with every vertex outside the same frustum plane
+        const int *indices = FaceIndices(i);
+        int sides = FaceSize(i);
+        int inside = outcodes[indices[0]];
+        int outside = inside;
+        for (int k = 1; k < sides; k++) {
+            inside &= outcodes[indices[k]];
+            outside |= outcodes[indices[k]];
+        }
+        if (inside & CLIP_FRUSTUM) {
+            continue;
+        }
+
         // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
+        vec3 normal = cull_normals[i].normalize();
+        vec3 view = screen_verts.world[FaceIndices(i)[1]] - camera.position;
         float dot = normal.dot(view);
 
         // Visible if dot of normal and line of sight is positive
         if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
             continue;
 
-        // Calculate surface normal
-        vec4 _v0 = model_matrix * vec4(verts[faces[i].indices[0]], 1.0);
-        vec4 _v1 = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec4 _v2 = model_matrix * vec4(verts[faces[i].indices[2]], 1.0);
-        vec3 v0 = vec3(_v0.x, _v0.y, _v0.z);
-        vec3 v1 = vec3(_v1.x, _v1.y, _v1.z);
-        vec3 v2 = vec3(_v2.x, _v2.y, _v2.z);
-        // Note: switching cross product A, B because of some weirdness with LH coordinate system
-        // vec3 surface_normal = ((v2-v1).cross(v0-v1)).normalize();
-        vec3 surface_normal = ((v0-v1).cross(v2-v1)).normalize();
-
-        // Calculate intensity
-        vec3 intensity;
-        if (MATERIAL_TYPE == CARTOON) {
-            intensity = material.CartoonIllumination(surface_normal, light_direction); 
-        }
-        else {
-            intensity = material.PhongIllumination(material.color, view_direction, surface_normal, light_direction, light);
-        }
-        
-
-        Uint8 r = (Uint8)floor(abs(intensity.x) * 255.0);
-        Uint8 g = (Uint8)floor(abs(intensity.y) * 255.0);
-        Uint8 b = (Uint8)floor(abs(intensity.z) * 255.0);
-
-        // Draw RGB scaled by intensity
-        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int _p0 = faces[i].indices[k];
-            int _p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 _h0 = perspective_transform * vec4(verts[_p0], 1.0);
-            vec4 _h1 = perspective_transform * vec4(verts[_p1], 1.0);
-            vec3 e0 = vec3(_h0.x/_h0.w, _h0.y/_h0.w, _h0.z/_h0.w);
-            vec3 e1 = vec3(_h1.x/_h1.w, _h1.y/_h1.w, _h1.z/_h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * e0.x + half_width;
-            float x1 = half_width * e1.x + half_width;
-            float y0 = half_height * e0.y + half_height;
-            float y1 = half_height * e1.y + half_height;
-            float z0 = e0.z;
-            float z1 = e1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                /* Assume convex polygon - don't shorten edges */
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z);
-                et.InsertEdge(y_min,e);
-            }
-        }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                }
-            }
-
-            // Update edges
-            aet.UpdateEdges(y);
+        visible_faces.push_back(i);
+        if (outside & CLIP_POLYGON) {
+            clipped_faces.push_back(i);
         }
     }
 }
 
-void Model::DrawGouraud(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]) {
-    // Apply transformation matrices to get from
-    // Model -> World -> Screen 
-
-    // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
-    mat4 view_matrix = camera.GetViewMatrix();
-    mat4 perspective_matrix = camera.GetPerspectiveMatrix();
-    mat4 model_view_matrix = view_matrix * model_matrix;
-    mat4 perspective_transform = perspective_matrix * model_view_matrix;
-
-    // Calculate viewing and lighting direction (assume both are infinitely far away)
-    vec4 _center = model_matrix * vec4(0.0, 0.0, 0.0, 1.0);
-    vec3 center = vec3(_center.x, _center.y, _center.z);
-    vec3 view_direction = (camera.position - center).normalize();
-    vec3 light_direction = light.LightDirection(center);
-
-    // Calculate face and vertex normals
-    std::vector< vec3 > face_normals;
-    std::vector< vec3 > vert_normals;
-    std::vector< vec3 > vert_intensities;
-    face_normals.resize(faces.size());
-    vert_normals.resize(verts.size());
-    vert_intensities.resize(verts.size());
-    for (size_t i = 0; i < faces.size(); i++) {
-        // Calculate surface normal
-        vec4 _v0 = model_matrix * vec4(verts[faces[i].indices[0]], 1.0);
-        vec4 _v1 = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec4 _v2 = model_matrix * vec4(verts[faces[i].indices[2]], 1.0);
-        vec3 v0 = vec3(_v0.x, _v0.y, _v0.z);
-        vec3 v1 = vec3(_v1.x, _v1.y, _v1.z);
-        vec3 v2 = vec3(_v2.x, _v2.y, _v2.z);
-        // Note: switching cross product A, B because of some weirdness with LH coordinate system
-        // vec3 surface_normal = ((v2-v1).cross(v0-v1)).normalize();
-        face_normals[i] = ((v0-v1).cross(v2-v1)).normalize();
-    }
-
-    // Calculate verts normals
-    for (size_t i = 0; i < verts.size(); i++) {
-        // Get all faces containing this vertex
-        std::vector<int> faces_index;
-        for (size_t j = 0; j < faces.size(); j++) {
-            // Loop through all indices of the face to check if the vertex is in it
-            for (size_t k = 0; k < faces[j].indices.size(); k++) {
-                if ((unsigned int)faces[j].indices[k] == i) {
-                    faces_index.push_back(j);
-                }
+void Model::ClipFaces(const std::vector< vec3 > *vecs, bool use_verts, int width, int height) {
+    float half_width = width / 2.0;
+    float half_height = height / 2.0;
+    clip_offsets.assign(1, 0);
+    clip_verts.clear();
+
+    bool empty = false;
+    for (int i : clipped_faces) {
+        const int *indices = FaceIndices(i);
+        int sides = FaceSize(i);
+        int outside = 0;
+        clip_poly.resize(sides);
+        for (int k = 0; k < sides; k++) {
+            int p = indices[k];
+            ClipVertex &v = clip_poly[k];
+            v.position = screen_verts.clip[p];
+            v.vec = vecs ? (*vecs)[p] : vec3();
+            v.vert = use_verts ? mesh->verts[p] : vec3();
+            outside |= screen_verts.outcodes[p];
+        }
+
+        // The polygon is drawn from clip_verts from now on, even if nothing is left
+        face_clip[i] = clip_offsets.size() - 1;
+        if (ClipPolygon(clip_poly, clip_scratch, outside & CLIP_POLYGON)) {
+            for (const ClipVertex &c : clip_poly) {
+                RasterVertex v;
+                ClipToScreen(c.position, half_width, half_height, v.x, v.y, v.z);
+                v.vec = c.vec;
+                v.vert = c.vert;
+                clip_verts.push_back(v);
             }
         }
-        // Then average their normals
-        vec3 normal_sum(0, 0, 0);
-        for (size_t i = 0; i < faces_index.size(); i++) {
-            normal_sum += face_normals[faces_index[i]];
-        }
-        vert_normals[i] = (normal_sum / faces_index.size()).normalize();
-
-        // Calculate intensity
-        if (MATERIAL_TYPE == CARTOON) {
-            vert_intensities[i] = material.CartoonIllumination(vert_normals[i], light_direction); 
-        }
         else {
-            vert_intensities[i] = material.PhongIllumination(material.color, view_direction, vert_normals[i], light_direction, light); 
+            empty = true;
         }
+        clip_offsets.push_back(clip_verts.size());
     }
 
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
-
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int _p0 = faces[i].indices[k];
-            int _p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 _h0 = perspective_transform * vec4(verts[_p0], 1.0);
-            vec4 _h1 = perspective_transform * vec4(verts[_p1], 1.0);
-            vec3 e0 = vec3(_h0.x/_h0.w, _h0.y/_h0.w, _h0.z/_h0.w);
-            vec3 e1 = vec3(_h1.x/_h1.w, _h1.y/_h1.w, _h1.z/_h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * e0.x + half_width;
-            float x1 = half_width * e1.x + half_width;
-            float y0 = half_height * e0.y + half_height;
-            float y1 = half_height * e1.y + half_height;
-            float z0 = e0.z;
-            float z1 = e1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                // Assume convex polygon - don't shorten edges
-
-                // Get lighting intensity at ends of edge
-                vec3 vert_intensity0 = vert_intensities[_p0];
-                vec3 vert_intensity1 = vert_intensities[_p1];
-
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                vec3 vec_min;
-                vec3 del_vec;
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                    vec_min = vert_intensity0;
-                    del_vec = (1.0/(y1-y0))*(vert_intensity1 - vert_intensity0);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                    vec_min = vert_intensity1;
-                    del_vec = (1.0/(y0-y1))*(vert_intensity0 - vert_intensity1);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z, vec_min, del_vec);
-                et.InsertEdge(y_min,e);
-            }
-        }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                // Interpolate vertex intensity horizontally
-                vec3 start = e0->vec_min;
-                vec3 end = e1->vec_min;
-                vec3 hor_del_vec = (1.0/(ix1 - ix0))*(end - start);
-                vec3 intensity = start;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-
-                        // Draw RGB scaled by intensity
-                        Uint8 r = (Uint8)floor(abs(intensity.x) * 255.0);
-                        Uint8 g = (Uint8)floor(abs(intensity.y) * 255.0);
-                        Uint8 b = (Uint8)floor(abs(intensity.z) * 255.0);
-
-                        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                    intensity = intensity + hor_del_vec;
-                }
-            }
-
-            // Update edges
-            aet.UpdateEdges(y);
-        }
+    if (empty) {
+        // Clipped away entirely, e.g. a face in front of the camera but behind the near plane
+        visible_faces.erase(std::remove_if(visible_faces.begin(), visible_faces.end(), [&](int i) {
+            int c = face_clip[i];
+            return c >= 0 && clip_offsets[c] == clip_offsets[c + 1];
+        }), visible_faces.end());
     }
 }
 
-void Model::DrawPhong(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT], bool render_normal) {
-    // Apply transformation matrices to get from
-    // Model -> World -> Screen 
-
-    // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
-    mat4 view_matrix = camera.GetViewMatrix();
-    mat4 perspective_matrix = camera.GetPerspectiveMatrix();
-    mat4 model_view_matrix = view_matrix * model_matrix;
-    mat4 perspective_transform = perspective_matrix * model_view_matrix;
-
-    // Calculate viewing and lighting direction (assume both are infinitely far away)
-    vec4 _center = model_matrix * vec4(0.0, 0.0, 0.0, 1.0);
-    vec3 center = vec3(_center.x, _center.y, _center.z);
-    vec3 view_direction = (camera.position - center).normalize();
-    vec3 light_direction = light.LightDirection(center);
-
-    // Calculate face and vertex normals
-    std::vector< vec3 > face_normals;
-    std::vector< vec3 > vert_normals;
-    std::vector< vec3 > vert_intensities;
-    face_normals.resize(faces.size());
-    vert_normals.resize(verts.size());
-    vert_intensities.resize(verts.size());
-    for (size_t i = 0; i < faces.size(); i++) {
-        // Calculate surface normal
-        vec4 _v0 = model_matrix * vec4(verts[faces[i].indices[0]], 1.0);
-        vec4 _v1 = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec4 _v2 = model_matrix * vec4(verts[faces[i].indices[2]], 1.0);
-        vec3 v0 = vec3(_v0.x, _v0.y, _v0.z);
-        vec3 v1 = vec3(_v1.x, _v1.y, _v1.z);
-        vec3 v2 = vec3(_v2.x, _v2.y, _v2.z);
-        // Note: switching cross product A, B because of some weirdness with LH coordinate system
-        // vec3 surface_normal = ((v2-v1).cross(v0-v1)).normalize();
-        face_normals[i] = ((v0-v1).cross(v2-v1)).normalize();
+void Model::GatherFace(int i, const std::vector< vec3 > *vecs, bool use_verts, RasterContext &context) {
+    int c = face_clip[i];
+    if (c >= 0) {
+        context.face_verts.assign(clip_verts.begin() + clip_offsets[c], clip_verts.begin() + clip_offsets[c + 1]);
+        return;
     }
-
-    // Calculate verts normals
-    for (size_t i = 0; i < verts.size(); i++) {
-        // Get all faces containing this vertex
-        std::vector<int> faces_index;
-        for (size_t j = 0; j < faces.size(); j++) {
-            // Loop through all indices of the face to check if the vertex is in it
-            for (size_t k = 0; k < faces[j].indices.size(); k++) {
-                if ((unsigned int)faces[j].indices[k] == i) {
-                    faces_index.push_back(j);
-                }
-            }
-        }
-        // Then average their normals
-        vec3 normal_sum(0, 0, 0);
-        for (size_t i = 0; i < faces_index.size(); i++) {
-            normal_sum += face_normals[faces_index[i]];
+    const int *indices = FaceIndices(i);
+    int sides = FaceSize(i);
+    context.face_verts.resize(sides);
+    for (int k = 0; k < sides; k++) {
+        int p = indices[k];
+        RasterVertex &v = context.face_verts[k];
+        v.x = screen_verts.x[p];
+        v.y = screen_verts.y[p];
+        v.z = screen_verts.z[p];
+        if (vecs) {
+            v.vec = (*vecs)[p];
+        }
+        if (use_verts) {
+            v.vert = mesh->verts[p];
         }
-        vert_normals[i] = (normal_sum / faces_index.size()).normalize();
     }
+}
 
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
-
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int _p0 = faces[i].indices[k];
-            int _p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 _h0 = perspective_transform * vec4(verts[_p0], 1.0);
-            vec4 _h1 = perspective_transform * vec4(verts[_p1], 1.0);
-            vec3 e0 = vec3(_h0.x/_h0.w, _h0.y/_h0.w, _h0.z/_h0.w);
-            vec3 e1 = vec3(_h1.x/_h1.w, _h1.y/_h1.w, _h1.z/_h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * e0.x + half_width;
-            float x1 = half_width * e1.x + half_width;
-            float y0 = half_height * e0.y + half_height;
-            float y1 = half_height * e1.y + half_height;
-            float z0 = e0.z;
-            float z1 = e1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                // Assume convex polygon - don't shorten edges
-
-                // Get vertex normal at ends of edge
-                vec3 vert_norm0 = vert_normals[_p0];
-                vec3 vert_norm1 = vert_normals[_p1];
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                vec3 vec_min;
-                vec3 del_vec;
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                    vec_min = vert_norm0;
-                    del_vec = (1.0/(y1-y0))*(vert_norm1 - vert_norm0);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                    vec_min = vert_norm1;
-                    del_vec = (1.0/(y0-y1))*(vert_norm0 - vert_norm1);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z, vec_min, del_vec);
-                et.InsertEdge(y_min,e);
-            }
+ClipRect Model::FaceBounds(int i, int width, int height) {
+    float min_x, max_x, min_y, max_y;
+    int c = face_clip[i];
+    if (c >= 0) {
+        const RasterVertex *v = &clip_verts[clip_offsets[c]];
+        int sides = clip_offsets[c + 1] - clip_offsets[c];
+        min_x = max_x = v[0].x;
+        min_y = max_y = v[0].y;
+        for (int n = 1; n < sides; n++) {
+            min_x = std::min(min_x, v[n].x);
+            max_x = std::max(max_x, v[n].x);
+            min_y = std::min(min_y, v[n].y);
+            max_y = std::max(max_y, v[n].y);
         }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                // Interpolate vertex intensity horizontally
-                vec3 start = e0->vec_min;
-                vec3 end = e1->vec_min;
-                vec3 hor_del_vec = (1.0/(ix1 - ix0))*(end - start);
-                vec3 norm = start;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-
-                        // Calculate intensity
-                        norm = norm.normalize();
-                        vec3 intensity;
-                        if (MATERIAL_TYPE == CARTOON) {
-                            intensity = material.CartoonIllumination(norm, light_direction); 
-                        }
-                        else {
-                            intensity = material.PhongIllumination(material.color, view_direction, norm, light_direction, light); 
-                        }
-
-                        Uint8 r, g, b;
-                        if (!render_normal) {
-                            // Draw RGB scaled by intensity
-                            r = (Uint8)floor(abs(intensity.x) * 255.0);
-                            g = (Uint8)floor(abs(intensity.y) * 255.0);
-                            b = (Uint8)floor(abs(intensity.z) * 255.0);
-                        }
-                        else {
-                            // Draw RGB based on surface normal
-                            r = (Uint8)floor(abs(norm.x) * 255.0);
-                            g = (Uint8)floor(abs(norm.y) * 255.0);
-                            b = (Uint8)floor(abs(norm.z) * 255.0);
-                        }
-
-                        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                    norm = norm + hor_del_vec;
-                }
-            }
-
-            // Update edges
-            aet.UpdateEdges(y);
+    }
+    else {
+        const int *indices = FaceIndices(i);
+        int sides = FaceSize(i);
+        min_x = max_x = screen_verts.x[indices[0]];
+        min_y = max_y = screen_verts.y[indices[0]];
+        for (int n = 1; n < sides; n++) {
+            min_x = std::min(min_x, screen_verts.x[indices[n]]);
+            max_x = std::max(max_x, screen_verts.x[indices[n]]);
+            min_y = std::min(min_y, screen_verts.y[indices[n]]);
+            max_y = std::max(max_y, screen_verts.y[indices[n]]);
         }
     }
+    ClipRect bounds;
+    bounds.x0 = (int)std::min(std::max(floorf(min_x) - 1, 0.0f), (float)width);
+    bounds.y0 = (int)std::min(std::max(floorf(min_y) - 1, 0.0f), (float)height);
+    bounds.x1 = (int)std::max(std::min(ceilf(max_x) + 1, width - 1.0f), -1.0f);
+    bounds.y1 = (int)std::max(std::min(ceilf(max_y) + 1, height - 1.0f), -1.0f);
+    return bounds;
 }
 
-void Model::DrawEnvironment(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]) {
-    // Apply transformation matrices to get from
-    // Model -> World -> Screen 
-
-    // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
-    mat4 view_matrix = camera.GetViewMatrix();
-    mat4 perspective_matrix = camera.GetPerspectiveMatrix();
-    mat4 model_view_matrix = view_matrix * model_matrix;
-    mat4 perspective_transform = perspective_matrix * model_view_matrix;
-
-    // Calculate viewing and lighting direction (assume both are infinitely far away)
-    vec4 _center = model_matrix * vec4(0.0, 0.0, 0.0, 1.0);
-    vec3 center = vec3(_center.x, _center.y, _center.z);
-    vec3 view_direction = (camera.position - center).normalize();
-    vec3 light_direction = light.LightDirection(center);
-
-    // Calculate face and vertex normals
-    std::vector< vec3 > face_normals;
-    std::vector< vec3 > vert_normals;
-    std::vector< vec3 > vert_intensities;
-    face_normals.resize(faces.size());
-    vert_normals.resize(verts.size());
-    vert_intensities.resize(verts.size());
-    for (size_t i = 0; i < faces.size(); i++) {
-        // Calculate surface normal
-        vec4 _v0 = model_matrix * vec4(verts[faces[i].indices[0]], 1.0);
-        vec4 _v1 = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec4 _v2 = model_matrix * vec4(verts[faces[i].indices[2]], 1.0);
-        vec3 v0 = vec3(_v0.x, _v0.y, _v0.z);
-        vec3 v1 = vec3(_v1.x, _v1.y, _v1.z);
-        vec3 v2 = vec3(_v2.x, _v2.y, _v2.z);
-        // Note: switching cross product A, B because of some weirdness with LH coordinate system
-        // vec3 surface_normal = ((v2-v1).cross(v0-v1)).normalize();
-        face_normals[i] = ((v0-v1).cross(v2-v1)).normalize();
+static Uint64 SumCounts(const std::vector< Uint64 > &counts) {
+    Uint64 total = 0;
+    for (Uint64 count : counts) {
+        total += count;
     }
+    return total;
+}
 
-    // Calculate verts normals
-    for (size_t i = 0; i < verts.size(); i++) {
-        // Get all faces containing this vertex
-        std::vector<int> faces_index;
-        for (size_t j = 0; j < faces.size(); j++) {
-            // Loop through all indices of the face to check if the vertex is in it
-            for (size_t k = 0; k < faces[j].indices.size(); k++) {
-                if ((unsigned int)faces[j].indices[k] == i) {
-                    faces_index.push_back(j);
-                }
-            }
-        }
-        // Then average their normals
-        vec3 normal_sum(0, 0, 0);
-        for (size_t i = 0; i < faces_index.size(); i++) {
-            normal_sum += face_normals[faces_index[i]];
-        }
-        vert_normals[i] = (normal_sum / faces_index.size()).normalize();
+// Hand the rasterizer's tallies to the profiler, reset them and return the pixels written
+static Uint64 CountRaster(Profiler *profiler, RasterCounts &counts) {
+    if (profiler) {
+        profiler->Count(PROFILE_RASTERIZED, counts.polygons);
+        profiler->Count(PROFILE_TESTED, counts.tested);
+        profiler->Count(PROFILE_WRITTEN, counts.written);
     }
+    Uint64 written = counts.written;
+    counts = RasterCounts();
+    return written;
+}
 
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
-
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int _p0 = faces[i].indices[k];
-            int _p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 _h0 = perspective_transform * vec4(verts[_p0], 1.0);
-            vec4 _h1 = perspective_transform * vec4(verts[_p1], 1.0);
-            vec3 e0 = vec3(_h0.x/_h0.w, _h0.y/_h0.w, _h0.z/_h0.w);
-            vec3 e1 = vec3(_h1.x/_h1.w, _h1.y/_h1.w, _h1.z/_h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * e0.x + half_width;
-            float x1 = half_width * e1.x + half_width;
-            float y0 = half_height * e0.y + half_height;
-            float y1 = half_height * e1.y + half_height;
-            float z0 = e0.z;
-            float z1 = e1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                // Assume convex polygon - don't shorten edges
-
-                // Get vertex normal at ends of edge
-                vec3 vert_norm0 = vert_normals[_p0];
-                vec3 vert_norm1 = vert_normals[_p1];
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                vec3 vec_min;
-                vec3 del_vec;
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                    vec_min = vert_norm0;
-                    del_vec = (1.0/(y1-y0))*(vert_norm1 - vert_norm0);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                    vec_min = vert_norm1;
-                    del_vec = (1.0/(y0-y1))*(vert_norm0 - vert_norm1);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z, vec_min, del_vec);
-                et.InsertEdge(y_min,e);
-            }
-        }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                // Interpolate vertex intensity horizontally
-                vec3 start = e0->vec_min;
-                vec3 end = e1->vec_min;
-                vec3 hor_del_vec = (1.0/(ix1 - ix0))*(end - start);
-                vec3 norm = start;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-
-                        // Calculate intensity
-                        norm = norm.normalize();
-
-                        // Get corresponding color from texture map
-                        vec3 texture = material.GetTexture(norm);
-
-                        vec3 intensity = material.PhongIllumination(texture, view_direction, norm, light_direction, light); 
-
-                        // Draw RGB based on intensity
-                        Uint8 r = (Uint8)floor(abs(intensity.x) * 255.0);
-                        Uint8 g = (Uint8)floor(abs(intensity.y) * 255.0);
-                        Uint8 b = (Uint8)floor(abs(intensity.z) * 255.0);
-
-                        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                    norm = norm + hor_del_vec;
-                }
-            }
+template <int ATTRIBS, typename Shade>
+Uint64 Model::RasterizeFaces(const std::vector< vec3 > *vecs, bool use_verts, DepthBuffer &depth, Shade shade) {
+    Uint64 start = ProfileStart(profiler);
+    if (tiles == NULL) {
+        ClipRect screen(0, 0, depth.width - 1, depth.height - 1);
+        for (size_t k = 0; k < visible_faces.size(); k++) {
+            int i = visible_faces[k];
+            GatherFace(i, vecs, use_verts, raster);
+            FillPolygon<ATTRIBS>(raster_type, raster, screen, depth,
+                [&](int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+                    shade(i, x, y, z, vec, vert, dvert);
+                });
+        }
+        ProfileLap(profiler, PROFILE_RASTERIZE, start);
+        return CountRaster(profiler, raster.counts);
+    }
 
-            // Update edges
-            aet.UpdateEdges(y);
-        }
+    // Screen bounds of each face
+    std::vector< ClipRect > &bounds = tiles->bounds;
+    bounds.resize(visible_faces.size());
+    for (size_t k = 0; k < visible_faces.size(); k++) {
+        bounds[k] = FaceBounds(visible_faces[k], depth.width, depth.height);
+    }
+    TileBins &bins = tiles->bins;
+    bins.Resize(depth.width, depth.height);
+    bins.Bin(visible_faces, bounds);
+    start = ProfileLap(profiler, PROFILE_SETUP, start);
+
+    // Each tile draws its faces in order, so every pixel sees the same sequence of depth tests
+    auto task = [&](int tile, int thread) {
+        RasterContext &context = tiles->contexts[thread];
+        ClipRect clip = bins.TileRect(tile);
+        for (int j = bins.offsets[tile]; j < bins.offsets[tile + 1]; j++) {
+            int i = bins.faces[j];
+            GatherFace(i, vecs, use_verts, context);
+            FillPolygon<ATTRIBS>(raster_type, context, clip, depth,
+                [&](int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+                    shade(i, x, y, z, vec, vert, dvert);
+                });
+        }
+    };
+    tiles->pool.Run(bins.NumTiles(), task);
+    ProfileLap(profiler, PROFILE_RASTERIZE, start);
+    Uint64 written = 0;
+    for (RasterContext &context : tiles->contexts) {
+        written += CountRaster(profiler, context.counts);
     }
+    return written;
 }
 
-void Model::DrawTexture(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]) {
+template <typename Shader>
+void Model::Draw(Camera &camera, Light &light, const Instance &instance, Framebuffer &framebuffer, DepthBuffer &depth) {
     // Apply transformation matrices to get from
     // Model -> World -> Screen 
+    ShadeContext context(*this, camera, light, *instance.material, framebuffer);
 
     // Calculate transformation matrix
-    mat4 model_matrix = translate_matrix * rotate_matrix * scale_matrix;
+    mat4 model_matrix = instance.ModelMatrix();
     mat4 view_matrix = camera.GetViewMatrix();
     mat4 perspective_matrix = camera.GetPerspectiveMatrix();
     mat4 model_view_matrix = view_matrix * model_matrix;
     mat4 perspective_transform = perspective_matrix * model_view_matrix;
+    context.model_matrix = model_matrix;
 
     // Calculate viewing and lighting direction (assume both are infinitely far away)
     vec4 _center = model_matrix * vec4(0.0, 0.0, 0.0, 1.0);
     vec3 center = vec3(_center.x, _center.y, _center.z);
-    vec3 view_direction = (camera.position - center).normalize();
-    vec3 light_direction = light.LightDirection(center);
-
-    // Calculate face and vertex normals
-    std::vector< vec3 > face_normals;
-    std::vector< vec3 > vert_normals;
-    std::vector< vec3 > vert_intensities;
-    face_normals.resize(faces.size());
-    vert_normals.resize(verts.size());
-    vert_intensities.resize(verts.size());
-    for (size_t i = 0; i < faces.size(); i++) {
-        // Calculate surface normal
-        vec4 _v0 = model_matrix * vec4(verts[faces[i].indices[0]], 1.0);
-        vec4 _v1 = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec4 _v2 = model_matrix * vec4(verts[faces[i].indices[2]], 1.0);
-        vec3 v0 = vec3(_v0.x, _v0.y, _v0.z);
-        vec3 v1 = vec3(_v1.x, _v1.y, _v1.z);
-        vec3 v2 = vec3(_v2.x, _v2.y, _v2.z);
-        // Note: switching cross product A, B because of some weirdness with LH coordinate system
-        // vec3 surface_normal = ((v2-v1).cross(v0-v1)).normalize();
-        face_normals[i] = ((v0-v1).cross(v2-v1)).normalize();
+    context.view_direction = (camera.position - center).normalize();
+    context.light_direction = light.LightDirection(center);
+
+    // Transform verts (and normals if shaded with them) to screen space
+    Uint64 start = ProfileStart(profiler);
+    ProcessVerts(model_matrix, perspective_transform, Shader::NORMALS, depth.width, depth.height);
+    start = ProfileLap(profiler, PROFILE_TRANSFORM, start);
+    CullFaces(model_matrix, camera);
+    start = ProfileLap(profiler, PROFILE_CULL, start);
+
+    Shader shader;
+    const std::vector< vec3 > *vecs = shader.Prepare(context);
+    start = ProfileLap(profiler, PROFILE_SHADE, start);
+    ClipFaces(vecs, Shader::VERTS, depth.width, depth.height);
+    ProfileLap(profiler, PROFILE_CLIP, start);
+    if (profiler) {
+        profiler->Count(PROFILE_FACES, NumFaces());
+        profiler->Count(PROFILE_CULLED, NumFaces() - visible_faces.size());
+        profiler->Count(PROFILE_CLIPPED, clipped_faces.size());
     }
-
-    // Calculate verts normals
-    for (size_t i = 0; i < verts.size(); i++) {
-        // Get all faces containing this vertex
-        std::vector<int> faces_index;
-        for (size_t j = 0; j < faces.size(); j++) {
-            // Loop through all indices of the face to check if the vertex is in it
-            for (size_t k = 0; k < faces[j].indices.size(); k++) {
-                if ((unsigned int)faces[j].indices[k] == i) {
-                    faces_index.push_back(j);
-                }
-            }
-        }
-        // Then average their normals
-        vec3 normal_sum(0, 0, 0);
-        for (size_t i = 0; i < faces_index.size(); i++) {
-            normal_sum += face_normals[faces_index[i]];
+    if (gbuffer == NULL || !Shader::DEFERRED) {
+        // Forward: shade every fragment that passes the depth test, even if a nearer one replaces it
+        Uint64 shaded = RasterizeFaces<Shader::ATTRIBS>(vecs, Shader::VERTS, depth,
+            [&](int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+                shader.Shade(context, i, x, y, z, vec, vert, dvert);
+            });
+        if (profiler) {
+            profiler->Count(PROFILE_SHADED, shaded);
         }
-        vert_normals[i] = (normal_sum / faces_index.size()).normalize();
+        return;
     }
 
-    // For each face in model
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        // Backface culling 
-        vec4 _normal = model_matrix * vec4(model_face_normals[i], 1.0);
-        vec3 normal = vec3(_normal.x, _normal.y, _normal.z).normalize();
-        vec4 _view = model_matrix * vec4(verts[faces[i].indices[1]], 1.0);
-        vec3 view = (vec3(_view.x, _view.y, _view.z) - camera.position);
-        float dot = normal.dot(view);
-
-        // Visible if dot of normal and line of sight is positive
-        if (BACK_FACE_CULLING && comparefloats(dot,0.0,FLOAT_TOL) <= 0)
-            continue;
-
-        EdgeTable et;
-        // For each edge in face 
-        for (unsigned int k = 0; k < faces[i].indices.size(); k++) {
-
-            // Get perspective transform of edge
-            int _p0 = faces[i].indices[k];
-            int _p1 = faces[i].indices[(k + 1) % faces[i].indices.size()];
-            vec4 _h0 = perspective_transform * vec4(verts[_p0], 1.0);
-            vec4 _h1 = perspective_transform * vec4(verts[_p1], 1.0);
-            vec3 e0 = vec3(_h0.x/_h0.w, _h0.y/_h0.w, _h0.z/_h0.w);
-            vec3 e1 = vec3(_h1.x/_h1.w, _h1.y/_h1.w, _h1.z/_h1.w);
-
-            // Scale normalized coordinates [-1, 1] to device coordinates [SCREEN_WIDTH, SCREEN_HEIGHT]
-            float half_width = SCREEN_WIDTH / 2.0;
-            float half_height = SCREEN_HEIGHT / 2.0;
-
-            float x0 = half_width * e0.x + half_width;
-            float x1 = half_width * e1.x + half_width;
-            float y0 = half_height * e0.y + half_height;
-            float y1 = half_height * e1.y + half_height;
-            float z0 = e0.z;
-            float z1 = e1.z;
-
-            // Round points 0 and 1
-            int iy0 = (int)round(y0);
-            int iy1 = (int)round(y1);
-
-            float inv_m = (x1 - x0)/(y1 - y0);
-
-            // Add only non-horizontal edges to ET
-            if (comparefloats(iy0, iy1, FLOAT_TOL) != 0) {
-
-                // Assume convex polygon - don't shorten edges
-
-                // Get vertex normal at ends of edge
-                vec3 vert_norm0 = vert_normals[_p0];
-                vec3 vert_norm1 = vert_normals[_p1];
-
-                // Add to edge table
-                int y_max;      // higher y value
-                int y_min;      // lower y value
-                float x_min;    // x value at lower edge
-                float z_min;    // z value at lower edge
-                float del_z;    // rate of change from z_min
-                vec3 vec_min;
-                vec3 del_vec;
-                vec3 vert_min;
-                vec3 del_vert;
-                if (iy0 < iy1) {
-                    // p0 is lower than p1
-                    y_max = iy1;
-                    y_min = iy0;
-                    x_min = x0;
-                    z_min = z0;
-                    del_z = (z1-z0)/(y1-y0);
-                    vec_min = vert_norm0;
-                    del_vec = (1.0/(y1-y0))*(vert_norm1 - vert_norm0);
-                    vert_min = verts[_p0];
-                    del_vert = (1.0/(y1-y0))*(verts[_p1] - verts[_p0]);
-                }
-                else {
-                    // p1 is lower than p0
-                    y_max = iy0;
-                    y_min = iy1;
-                    x_min = x1;
-                    z_min = z1;
-                    del_z = (z0-z1)/(y0-y1);
-                    vec_min = vert_norm1;
-                    del_vec = (1.0/(y0-y1))*(vert_norm0 - vert_norm1);
-                    vert_min = verts[_p1];
-                    del_vert = (1.0/(y0-y1))*(verts[_p0] - verts[_p1]);
-                }
-
-                Edge* e = new Edge(y_max, x_min, inv_m, z_min, del_z, vec_min, del_vec, vert_min, del_vert);
-                et.InsertEdge(y_min,e);
-            }
-        }
-
-        // Create active edge table 
-        ActiveEdgeTable aet;
-            
-        // Start at the first scanline containing an edge
-        // Stop when ET and AET are empty
-        for (int y = et.scanlines.begin()->first; (!et.IsEmpty() || !aet.IsEmpty()) && y < SCREEN_HEIGHT; y++) {
-            // Move edges from ET to AET
-            Edge* e;
-            while((e = et.RemoveEdge(y)) != nullptr) {
-                // AET is keyed by x_int
-                int x_int = (int)round(e->x_min);
-                aet.InsertEdge(x_int, e);
-            }
-
-            // Draw lines between pairs of edges in AET
-            assert((*aet.aet).size() % 2 == 0);
-            std::multimap<int,Edge*>::iterator it;
-            for (it = (*aet.aet).begin(); it != (*aet.aet).end(); it++) {
-                int ix0 = it->first;
-                Edge *e0 = it->second;
-                it++;
-                int ix1 = it->first;
-                Edge *e1 = it->second;
-
-                assert(ix0 >= 0 && ix0 < SCREEN_WIDTH);
-                assert(ix1 >= 0 && ix1 < SCREEN_WIDTH);
-
-                // Fill in points between and including edges
-                float z0 = e0->z_min;
-                float z1 = e1->z_min;
-                float hor_del_z = (z1 - z0)/(ix1 - ix0);
-                float z = z0;
-
-                // Interpolate vertex intensity horizontally
-                vec3 start = e0->vec_min;
-                vec3 end = e1->vec_min;
-                vec3 hor_del_vec = (1.0/(ix1 - ix0))*(end - start);
-                vec3 norm = start;
-
-                // Interpolate vertex position horizontally
-                vec3 v_start = e0->vert_min;
-                vec3 v_end = e1->vert_min;
-                vec3 hor_del_vert = (1.0/(ix1 - ix0))*(v_end - v_start);
-                vec3 vert = v_start;
-
-                for (int x = ix0; x <= ix1; x++) {
-                    // Only draw point if point is in front of current z value
-                    if (comparefloats(z, buffer[x][y], FLOAT_TOL) == -1) {
-                        buffer[x][y] = z;
-
-                        // Calculate intensity
-                        norm = norm.normalize();
-
-                        // Get corresponding color from texture map
-                        vert = vert.normalize();
-                        vec3 texture = material.GetTexture(vert);
-
-                        vec3 intensity = material.PhongIllumination(texture, view_direction, norm, light_direction, light); 
-
-                        // Draw RGB based on intensity
-                        Uint8 r = (Uint8)floor(abs(intensity.x) * 255.0);
-                        Uint8 g = (Uint8)floor(abs(intensity.y) * 255.0);
-                        Uint8 b = (Uint8)floor(abs(intensity.z) * 255.0);
-
-                        SDL_SetRenderDrawColor(renderer, r, g, b, 0xFF);
-                        SDL_RenderDrawPoint(renderer, x, y);
-                    }
-                    z += hor_del_z;
-                    norm = norm + hor_del_vec;
-                    vert = vert + hor_del_vert;
-                }
-            }
-
-            // Update edges
-            aet.UpdateEdges(y);
-        }
+    // Deferred geometry pass: the last fragment stored at a pixel is the nearest one,
+    // shaded with the inputs of its own draw by ShadeDeferred after every draw of the frame
+    GBuffer &g = *gbuffer;
+    g.Reserve(depth.width, depth.height, Shader::ATTRIBS);
+    int id = g.AddDraw(GBufferDraw(this, instance.material, context.model_matrix, context.view_direction, context.light_direction));
+    RasterizeFaces<Shader::ATTRIBS>(vecs, Shader::VERTS, depth,
+        [&](int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+            g.Set<Shader::ATTRIBS>(x, y, i, id, vec, vert, dvert);
+        });
+
+    // Only pixels inside the bounds of the visible faces can have been stored
+    for (size_t k = 0; k < visible_faces.size(); k++) {
+        ClipRect bounds = FaceBounds(visible_faces[k], depth.width, depth.height);
+        g.Extend(bounds.x0, bounds.y0, bounds.x1, bounds.y1);
     }
 }
-//=============================================
-// Resize Model
-//=============================================
-// scale the model into the range of [ -0.9, 0.9 ]
-void Model::ResizeModel(void) 
-{
-    // bound
-    vec3 min, max;
-    if (!CalcBound(min, max)) {
-        return;
-    }
 
-    // max side
-    vec3 size = max - min;
-
-    float r = size.x;
-    if (size.y > r) {
-        r = size.y;
+template <typename Shader>
+static void ShadeGBuffer(Camera &camera, Light &light, GBuffer &g, TileRenderer *tiles, Profiler *profiler, Framebuffer &framebuffer, DepthBuffer &depth) {
+    if (!Shader::DEFERRED) {
+        return;
     }
-    if (size.z > r) {
-        r = size.z;
+    Uint64 start = ProfileStart(profiler);
+
+    // Each draw's inputs as its forward draw saw them, so the image is identical
+    std::vector< ShadeContext > contexts;
+    contexts.reserve(g.draws.size());
+    for (const GBufferDraw &draw : g.draws) {
+        contexts.emplace_back(*draw.model, camera, light, *draw.material, framebuffer);
+        contexts.back().model_matrix = draw.model_matrix;
+        contexts.back().view_direction = draw.view_direction;
+        contexts.back().light_direction = draw.light_direction;
     }
 
-    if (r < 1e-6f) {
-        r = 0;
+    Shader shader;
+    const vec3 none = vec3();
+    auto shade_rect = [&](const ClipRect &rect) {
+        Uint64 count = 0;
+        for (int y = rect.y0; y <= rect.y1; y++) {
+            int *faces = &g.faces[y * g.width];
+            const int *instances = &g.instances[y * g.width];
+            const float *row = depth.Row(y);
+            for (int x = rect.x0; x <= rect.x1; x++) {
+                int i = faces[x];
+                if (i == GBUFFER_EMPTY) {
+                    continue;
+                }
+                faces[x] = GBUFFER_EMPTY;
+                int p = y * g.width + x;
+                shader.Shade(contexts[instances[x]], i, x, y, row[x],
+                    Shader::ATTRIBS >= 3 ? g.vecs[p] : none,
+                    Shader::ATTRIBS >= 6 ? g.verts[p] : none,
+                    Shader::ATTRIBS >= 6 ? g.dverts[p] : none);
+                count++;
+            }
+        }
+        return count;
+    };
+
+    ClipRect rect(g.x0, g.y0, g.x1, g.y1);
+    Uint64 shaded = 0;
+    if (tiles == NULL) {
+        shaded = shade_rect(rect);
     }
     else {
-        r = 1.0 / r;
+        // Screen tiles overlapping the stored pixels, each shaded by one thread
+        TileBins &bins = tiles->bins;
+        bins.Resize(depth.width, depth.height);
+        auto task = [&](int tile, int thread) {
+            ClipRect tile_rect = bins.TileRect(tile);
+            tile_rect.x0 = std::max(tile_rect.x0, rect.x0);
+            tile_rect.y0 = std::max(tile_rect.y0, rect.y0);
+            tile_rect.x1 = std::min(tile_rect.x1, rect.x1);
+            tile_rect.y1 = std::min(tile_rect.y1, rect.y1);
+            if (tile_rect.x0 <= tile_rect.x1 && tile_rect.y0 <= tile_rect.y1) {
+                tiles->counts[thread] += shade_rect(tile_rect);
+            }
+        };
+        tiles->counts.assign(tiles->pool.num_threads, 0);
+        tiles->pool.Run(bins.NumTiles(), task);
+        shaded = SumCounts(tiles->counts);
     }
-
-    // scale
-    for (unsigned int i = 0; i < verts.size(); i++) {
-        // [0, 1]
-        verts[i] = (verts[i] - min) * r;
-
-        // [-1, 1]
-        verts[i] = verts[i] * 2.0 - vec3(1.0, 1.0, 1.0);
-
-        // [-0.9, 0.9]
-        verts[i] *= 0.9;
+    g.Reset();
+    ProfileLap(profiler, PROFILE_SHADE, start);
+    if (profiler) {
+        profiler->Count(PROFILE_SHADED, shaded);
     }
 }
 
-bool Model::CalcBound(vec3& min, vec3& max) 
-{
-    if (verts.size() <= 0) {
-        return false;
+void ShadeDeferred(RenderType type, Camera &camera, Light &light, GBuffer &gbuffer, TileRenderer *tiles, Profiler *profiler, Framebuffer &framebuffer, DepthBuffer &depth) {
+    // Indexed by RenderType like Render's kernels, policies that aren't DEFERRED stored nothing
+    typedef void (*ShadeKernel)(Camera&, Light&, GBuffer&, TileRenderer*, Profiler*, Framebuffer&, DepthBuffer&);
+    static const ShadeKernel kernels[] = {
+        NULL,
+        &ShadeGBuffer< FacesShader >,
+        &ShadeGBuffer< DepthShader >,
+        &ShadeGBuffer< NormalShader >,
+        &ShadeGBuffer< FlatShader >,
+        &ShadeGBuffer< GouraudShader >,
+        &ShadeGBuffer< PhongShader >,
+        &ShadeGBuffer< TextureShader >,
+        &ShadeGBuffer< EnvironmentShader >,
+    };
+    static_assert(sizeof(kernels) / sizeof(kernels[0]) == ENVIRONMENT + 1, "one kernel per RenderType");
+    if (kernels[type] != NULL && !gbuffer.draws.empty()) {
+        kernels[type](camera, light, gbuffer, tiles, profiler, framebuffer, depth);
     }
+}
 
-    min = verts[0];
-    max = verts[0];
-
-    for (unsigned int i = 1; i < verts.size(); i++) {
-        vec3 v = verts[i];
-
-        if (v.x < min.x) {
-            min.x = v.x;
-        }
-        else if (v.x > max.x) {
-            max.x = v.x;
-        }
-
-        if (v.y < min.y) {
-            min.y = v.y;
-        }
-        else if (v.y > max.y) {
-            max.y = v.y;
-        }
-
-        if (v.z < min.z) {
-            min.z = v.z;
-        }
-        else if (v.z > max.z) {
-            max.z = v.z;
-        }
+void Model::Render(RenderType type, Camera &camera, Light &light, const std::vector< Instance* > &instances, Framebuffer &framebuffer, DepthBuffer &depth) {
+    // Indexed by RenderType, one pipeline instance per shading policy
+    static const RenderKernel kernels[] = {
+        &Model::DrawEdges,
+        &Model::Draw< FacesShader >,
+        &Model::Draw< DepthShader >,
+        &Model::Draw< NormalShader >,
+        &Model::Draw< FlatShader >,
+        &Model::Draw< GouraudShader >,
+        &Model::Draw< PhongShader >,
+        &Model::Draw< TextureShader >,
+        &Model::Draw< EnvironmentShader >,
+    };
+    static_assert(sizeof(kernels) / sizeof(kernels[0]) == ENVIRONMENT + 1, "one kernel per RenderType");
+
+    // Back to back, so the mesh and the buffers sized by it stay in cache
+    RenderKernel kernel = kernels[type];
+    for (const Instance *instance : instances) {
+        assert(instance->mesh == mesh);
+        (this->*kernel)(camera, light, *instance, framebuffer, depth);
     }
-
-    return true;
 }
 
-
 //=============================================
-// Transform Model
+// Transform Instance
 //=============================================
 
-void Model::Scale(float scale) 
+void Instance::Scale(float scale) 
 {
     scale_matrix[0] = scale;
     scale_matrix[5] = scale;
     scale_matrix[10] = scale;
+    if (scene) {
+        scene->Moved(scene_index);
+    }
 }
 
-void Model::Translate(vec3 offset) 
+void Instance::Translate(vec3 offset) 
 {
     translate_matrix[3] = offset.x;
     translate_matrix[7] = offset.y;
     translate_matrix[11] = offset.z;
+    if (scene) {
+        scene->Moved(scene_index);
+    }
 }
 
-void Model::Rotate(float x, float y, float z) 
+void Instance::Rotate(float x, float y, float z) 
 {
     // apply R = Rz(Ry(Rx))
     rotate_matrix[0] = cos(z) * cos(y);
@@ -1449,4 +554,7 @@ void Model::Rotate(float x, float y, float z)
     rotate_matrix[8] = cos(z) * sin(y) * cos(x) + sin(z) * sin(x);
     rotate_matrix[9] = sin(z) * sin(y) * cos(x) - cos(z) * sin(x);
     rotate_matrix[10] = cos(y) * cos(x);
+    if (scene) {
+        scene->Moved(scene_index);
+    }
 }
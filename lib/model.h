@@ -1,9 +1,18 @@
 #pragma once
 #include "mat4.h"
 #include "vec3.h"
+#include "vec4.h"
 #include "camera.h"
 #include "constants.h"
 #include "illumination.h"
+#include "framebuffer.h"
+#include "edgetable.h"
+#include "rasterizer.h"
+#include "clip.h"
+#include "tiles.h"
+#include "gbuffer.h"
+#include "profiler.h"
+#include "mesh.h"
 #include <SDL2/SDL.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,78 +20,176 @@
 #include <cmath>
 
 //================================
-// ModelFace
+// ScreenVerts
 //================================
-class ModelFace {
+// Verts after the vertex stage, stored as structure of arrays
+class ScreenVerts {
 public:
-    std::vector< int > indices;
+    std::vector< float > x;             // screen x
+    std::vector< float > y;             // screen y
+    std::vector< float > z;             // depth after perspective divide
+    std::vector< float > inv_w;         // 1/w
+    std::vector< vec4 > clip;           // position after the perspective transform, before the divide
+    std::vector< Uint16 > outcodes;     // ClipPlane bits of clip
+    std::vector< vec3 > world;          // world space position
+    std::vector< vec3 > normals;        // world space vertex normal
+    std::vector< vec3 > intensities;    // per vertex lighting (Gouraud)
 
 public:
-    ModelFace() {
+    ScreenVerts() {
     }
 
-    ~ModelFace() {
+    ~ScreenVerts() {
+    }
+
+    void Resize(size_t size) {
+        x.resize(size);
+        y.resize(size);
+        z.resize(size);
+        inv_w.resize(size);
+        clip.resize(size);
+        outcodes.resize(size);
+        world.resize(size);
     }
 };
 
+class Scene;
+
 //================================
-// Model
+// Instance
 //================================
-class Model {
+// One placement of a shared Mesh, drawn with its own transform and material
+class Instance {
 public:
-    std::vector< vec3 > verts;
-    std::vector< vec3 > model_face_normals;
-    std::vector< vec3 > face_colors;
-    std::vector< ModelFace > faces;
-    mat4 model_matrix;
+    const Mesh *mesh;
+    Material *material;
     mat4 scale_matrix;
     mat4 translate_matrix;
     mat4 rotate_matrix;
+    Scene *scene;                             // told when the transform changes, NULL outside a scene
+    int scene_index;
 
 public:
-    Model() : model_matrix(1), scale_matrix(1), translate_matrix(1), rotate_matrix(1) {
+    Instance(const Mesh *mesh = NULL, Material *material = NULL)
+        : mesh(mesh), material(material), scale_matrix(1), translate_matrix(1), rotate_matrix(1), scene(NULL), scene_index(-1) {
     }
 
-    ~Model() {
+    ~Instance() {
+    }
+
+    mat4 ModelMatrix(void) const {
+        return translate_matrix * rotate_matrix * scale_matrix;
     }
 
     //=============================================
-    // Load Model
+    // Transform Instance
     //=============================================
-    void Free(void);
 
-    bool LoadModel(const char* path);
+    void Scale(float scale);
 
-    //=============================================
-    // Render Model
-    //=============================================
-    void DrawEdges(Camera &camera, SDL_Renderer *renderer);
+    void Translate(vec3 offset);
 
-    void DrawFaces(Camera &camera, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT], bool render_depth);
+    void Rotate(float x, float y, float z);
+};
 
-    void DrawFlat(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]);
+//================================
+// Model
+//================================
+// Draws the instances of one Mesh. The per frame buffers of the pipeline are
+// sized by the mesh and reused by every instance drawn, so memory does not
+// grow with the number of instances.
+class Model {
+public:
+    const Mesh *mesh;
+    ScreenVerts screen_verts;                 // output of the vertex stage, reused every frame
+    std::vector< vec3 > cull_normals;         // model_face_normals transformed for back face culling
+    std::vector< int > visible_faces;         // faces that survived back face and frustum culling this frame
+    std::vector< int > clipped_faces;         // visible faces crossing the near or far plane or the guard band
+    std::vector< int > face_clip;             // per face, its polygon in clip_offsets if clipped this frame, else -1
+    std::vector< int > clip_offsets;          // CSR offsets into clip_verts, one polygon per clipped face
+    std::vector< RasterVertex > clip_verts;   // clipped polygons, in screen space
+    std::vector< ClipVertex > clip_poly;      // scratch for ClipPolygon
+    std::vector< ClipVertex > clip_scratch;
+    std::vector< vec3 > face_shades;          // per face RGB (flat)
+    RasterContext raster;                     // scan conversion scratch for the serial path
+    RasterType raster_type;
+    TileRenderer *tiles;                      // rasterize tiles in parallel, NULL for serial
+    GBuffer *gbuffer;                         // shade deferred through this G-buffer, NULL for forward
+    Profiler *profiler;                       // record stage times and counters, NULL for none
 
-    void DrawGouraud(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]);
+public:
+    Model(const Mesh *mesh = NULL) : mesh(mesh), raster_type(RASTER_TYPE), tiles(NULL), gbuffer(NULL), profiler(NULL) {
+    }
 
-    void DrawPhong(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT], bool render_normal);
+    ~Model() {
+    }
 
-    void DrawEnvironment(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]);
+    int NumFaces(void) const {
+        return mesh->NumFaces();
+    }
 
-    void DrawTexture(Camera &camera, Light &light, Material &material, SDL_Renderer *renderer, float buffer[SCREEN_WIDTH][SCREEN_HEIGHT]);
+    int FaceSize(int i) const {
+        return mesh->FaceSize(i);
+    }
 
-    //=============================================
-    // scale the model into the range of [ -0.9, 0.9 ]
-    void ResizeModel(void);
+    const int* FaceIndices(int i) const {
+        return mesh->FaceIndices(i);
+    }
 
-    bool CalcBound(vec3& min, vec3& max);
+    // Vertex stage: transform every vert to a width x height viewport once per instance
+    void ProcessVerts(mat4 &model_matrix, mat4 &perspective_transform, bool calc_normals, int width, int height);
 
-    //=============================================
-    // Transform Model
-    //=============================================
+    // Fill visible_faces with the faces facing the camera that are not
+    // entirely outside one frustum plane, and clipped_faces with those
+    // that need clipping
+    void CullFaces(mat4 &model_matrix, Camera &camera);
 
-    void Scale(float scale);
+    // Clip each of clipped_faces to a polygon in clip_verts for a width x height
+    // viewport, with vec and vert as GatherFace takes them. Faces with nothing
+    // left are removed from visible_faces.
+    void ClipFaces(const std::vector< vec3 > *vecs, bool use_verts, int width, int height);
 
-    void Translate(vec3 offset);
+    // Gather screen space verts of face i into context.face_verts, with vec taken from
+    // vecs (nullptr for none) and vert from the object space position if use_verts is set.
+    // Clipped faces are copied from their clipped polygon.
+    void GatherFace(int i, const std::vector< vec3 > *vecs, bool use_verts, RasterContext &context);
 
-    void Rotate(float x, float y, float z);
+    // Pixels of a width x height viewport face i may cover, padded a pixel for
+    // rounding in the scanline rasterizer
+    ClipRect FaceBounds(int i, int width, int height);
+
+    // Rasterize visible_faces in order, calling shade(face, x, y, z, vec, vert, dvert)
+    // for every pixel drawn. Runs on screen tiles in parallel when tiles is set.
+    // Returns the number of pixels drawn. Binning is timed as setup and the rest
+    // as rasterize.
+    template <int ATTRIBS, typename Shade>
+    Uint64 RasterizeFaces(const std::vector< vec3 > *vecs, bool use_verts, DepthBuffer &depth, Shade shade);
+
+    //=============================================
+    // Render Model
+    //=============================================
+    // Every render kernel has this signature, arguments a kernel doesn't need are ignored
+    typedef void (Model::*RenderKernel)(Camera &camera, Light &light, const Instance &instance, Framebuffer &framebuffer, DepthBuffer &depth);
+
+    // Draw each of instances, which must all share mesh, with the kernel for type,
+    // one after another through the same buffers. Instances are not culled here,
+    // pass only those a Scene query found in view.
+    void Render(RenderType type, Camera &camera, Light &light, const std::vector< Instance* > &instances, Framebuffer &framebuffer, DepthBuffer &depth);
+
+    // Wireframe, no depth test
+    void DrawEdges(Camera &camera, Light &light, const Instance &instance, Framebuffer &framebuffer, DepthBuffer &depth);
+
+    // The pipeline for one shading policy from shaders.h: vertex stage, back face
+    // culling, the policy's per frame setup, then rasterization interpolating
+    // Shader::ATTRIBS floats with Shader::Shade inlined into the span loop.
+    // With a gbuffer, policies marked DEFERRED instead only store each fragment's
+    // inputs and the draw they came from, for ShadeDeferred.
+    template <typename Shader>
+    void Draw(Camera &camera, Light &light, const Instance &instance, Framebuffer &framebuffer, DepthBuffer &depth);
 };
+
+// Deferred shading pass: shade every pixel the draws of type stored in gbuffer
+// since the last call once, with the inputs of the draw that stored it, then
+// empty the buffer. Call after every model of the frame has drawn. Runs on
+// screen tiles in parallel when tiles is set.
+void ShadeDeferred(RenderType type, Camera &camera, Light &light, GBuffer &gbuffer, TileRenderer *tiles, Profiler *profiler, Framebuffer &framebuffer, DepthBuffer &depth);
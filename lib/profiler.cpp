@@ -0,0 +1,172 @@
+#include "profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+
+const char *PROFILE_STAGE_NAMES[] = {
+    "clear",
+    "transform",
+    "cull",
+    "clip",
+    "setup",
+    "rasterize",
+    "shade",
+    "present",
+};
+static_assert(sizeof(PROFILE_STAGE_NAMES) / sizeof(PROFILE_STAGE_NAMES[0]) == PROFILE_STAGES, "one name per stage");
+
+const char *PROFILE_COUNTER_NAMES[] = {
+    "faces",
+    "culled",
+    "clipped",
+    "instances_culled",
+    "rasterized",
+    "tested",
+    "written",
+    "shaded",
+};
+static_assert(sizeof(PROFILE_COUNTER_NAMES) / sizeof(PROFILE_COUNTER_NAMES[0]) == PROFILE_COUNTERS, "one name per counter");
+
+//================================
+// ProfileSummary
+//================================
+
+ProfileSummary::ProfileSummary(const std::vector< double > &values) : mean(0), p50(0), p95(0), p99(0), max(0) {
+    if (values.empty()) {
+        return;
+    }
+    std::vector< double > sorted(values);
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double v : sorted) {
+        total += v;
+    }
+    mean = total / sorted.size();
+    p50 = Percentile(sorted, 50);
+    p95 = Percentile(sorted, 95);
+    p99 = Percentile(sorted, 99);
+    max = sorted.back();
+}
+
+double ProfileSummary::Percentile(const std::vector< double > &sorted, double p) {
+    // Nearest rank: the smallest value with at least p percent of the values at or below it
+    size_t rank = (size_t)ceil(p / 100.0 * sorted.size());
+    return sorted[std::max(rank, (size_t)1) - 1];
+}
+
+//================================
+// Profiler
+//================================
+
+Profiler::Profiler() {
+    frequency = (double)SDL_GetPerformanceFrequency();
+    frame_start = 0;
+    Reset();
+}
+
+void Profiler::Reset(void) {
+    memset(ticks, 0, sizeof(ticks));
+    memset(counts, 0, sizeof(counts));
+    frame_times.clear();
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        stage_times[s].clear();
+    }
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        counter_values[c].clear();
+    }
+}
+
+void Profiler::BeginFrame(void) {
+    memset(ticks, 0, sizeof(ticks));
+    memset(counts, 0, sizeof(counts));
+    frame_start = SDL_GetPerformanceCounter();
+}
+
+void Profiler::EndFrame(void) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    frame_times.push_back(1000.0 * (now - frame_start) / frequency);
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        stage_times[s].push_back(1000.0 * ticks[s] / frequency);
+    }
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        counter_values[c].push_back((double)counts[c]);
+    }
+}
+
+double Profiler::CounterMean(ProfileCounter counter) const {
+    return ProfileSummary(counter_values[counter]).mean;
+}
+
+void Profiler::Print(void) const {
+    printf("%d frames\n", NumFrames());
+    printf("%-16s %10s %10s %10s %10s %10s\n", "stage", "mean ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        ProfileSummary sum(stage_times[s]);
+        printf("%-16s %10.3f %10.3f %10.3f %10.3f %10.3f\n", PROFILE_STAGE_NAMES[s], sum.mean, sum.p50, sum.p95, sum.p99, sum.max);
+    }
+    ProfileSummary frame(frame_times);
+    printf("%-16s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "frame", frame.mean, frame.p50, frame.p95, frame.p99, frame.max);
+    printf("%-16s %10s %10s %10s %10s %10s\n", "counter", "mean", "p50", "p95", "p99", "max");
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        ProfileSummary sum(counter_values[c]);
+        printf("%-16s %10.0f %10.0f %10.0f %10.0f %10.0f\n", PROFILE_COUNTER_NAMES[c], sum.mean, sum.p50, sum.p95, sum.p99, sum.max);
+    }
+}
+
+bool Profiler::Write(const char* path) const {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        printf("Unable to open %s for writing\n", path);
+        return false;
+    }
+
+    size_t length = strlen(path);
+    bool json = length >= 5 && strcmp(path + length - 5, ".json") == 0;
+
+    // Stage and frame times in ms, then counters
+    std::vector< const char* > names;
+    std::vector< ProfileSummary > sums;
+    for (int s = 0; s < PROFILE_STAGES; s++) {
+        names.push_back(PROFILE_STAGE_NAMES[s]);
+        sums.push_back(ProfileSummary(stage_times[s]));
+    }
+    names.push_back("frame");
+    sums.push_back(ProfileSummary(frame_times));
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        names.push_back(PROFILE_COUNTER_NAMES[c]);
+        sums.push_back(ProfileSummary(counter_values[c]));
+    }
+
+    if (json) {
+        fprintf(file, "{\n  \"frames\": %d,\n", NumFrames());
+        for (size_t k = 0; k < names.size(); k++) {
+            if (k == 0) {
+                fprintf(file, "  \"stages_ms\": {\n");
+            }
+            else if (k == PROFILE_STAGES + 1) {
+                fprintf(file, "  },\n  \"counters\": {\n");
+            }
+            const ProfileSummary &sum = sums[k];
+            bool last = k == PROFILE_STAGES || k + 1 == names.size();
+            fprintf(file, "    \"%s\": {\"mean\": %.6f, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"max\": %.6f}%s\n",
+                names[k], sum.mean, sum.p50, sum.p95, sum.p99, sum.max, last ? "" : ",");
+        }
+        fprintf(file, "  }\n}\n");
+    }
+    else {
+        fprintf(file, "metric,unit,frames,mean,p50,p95,p99,max\n");
+        for (size_t k = 0; k < names.size(); k++) {
+            const ProfileSummary &sum = sums[k];
+            fprintf(file, "%s,%s,%d,%.6f,%.6f,%.6f,%.6f,%.6f\n", names[k], k <= PROFILE_STAGES ? "ms" : "count",
+                NumFrames(), sum.mean, sum.p50, sum.p95, sum.p99, sum.max);
+        }
+    }
+
+    bool ok = ferror(file) == 0;
+    if (fclose(file) != 0 || !ok) {
+        printf("Error writing %s\n", path);
+        return false;
+    }
+    return true;
+}
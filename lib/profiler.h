@@ -0,0 +1,121 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <vector>
+
+//================================
+// Profiler
+//================================
+
+// Pipeline stages timed every frame. Scan conversion, per face edge setup
+// and forward shading run interleaved in the span loop and are all charged
+// to rasterize; shade is the shading policy's per frame Prepare plus the
+// deferred shading pass.
+enum ProfileStage {
+    PROFILE_CLEAR,          // color and depth buffer clears
+    PROFILE_TRANSFORM,      // vertex stage
+    PROFILE_CULL,           // model frustum culling, back face culling and face frustum rejection
+    PROFILE_CLIP,           // clipping against the near and far planes and the guard band
+    PROFILE_SETUP,          // face bounds and tile binning
+    PROFILE_RASTERIZE,      // edge setup, scan conversion, depth test and forward shading
+    PROFILE_SHADE,          // per vertex or per face lighting and deferred shading
+    PROFILE_PRESENT,        // upload and show the color buffer
+    PROFILE_STAGES,
+};
+
+// Work counted every frame
+enum ProfileCounter {
+    PROFILE_FACES,          // faces submitted
+    PROFILE_CULLED,         // faces removed by back face culling, frustum rejection or clipping
+    PROFILE_CLIPPED,        // faces clipped
+    PROFILE_INSTANCES_CULLED, // instances skipped whole, outside the view frustum
+    PROFILE_RASTERIZED,     // polygons scan converted, once per screen tile they are drawn in
+    PROFILE_TESTED,         // pixels depth tested
+    PROFILE_WRITTEN,        // pixels that passed the depth test
+    PROFILE_SHADED,         // pixels shaded
+    PROFILE_COUNTERS,
+};
+
+extern const char *PROFILE_STAGE_NAMES[];
+extern const char *PROFILE_COUNTER_NAMES[];
+
+// Distribution of one metric over the recorded frames
+class ProfileSummary {
+public:
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+
+public:
+    ProfileSummary() : mean(0), p50(0), p95(0), p99(0), max(0) {
+    }
+
+    ProfileSummary(const std::vector< double > &values);
+
+    // Nearest rank percentile of sorted values
+    static double Percentile(const std::vector< double > &sorted, double p);
+};
+
+// Records the time of each stage and the counters of every frame with the
+// performance counter and reports their distribution. Stages and counters
+// hit more than once in a frame (one per model) add up. Not thread safe,
+// record from the thread that runs the frame.
+class Profiler {
+public:
+    double frequency;                                   // performance counter ticks per second
+    Uint64 frame_start;
+    Uint64 ticks[PROFILE_STAGES];                       // current frame
+    Uint64 counts[PROFILE_COUNTERS];
+    std::vector< double > frame_times;                  // ms per recorded frame
+    std::vector< double > stage_times[PROFILE_STAGES];
+    std::vector< double > counter_values[PROFILE_COUNTERS];
+
+public:
+    Profiler();
+
+    ~Profiler() {}
+
+    // Drop every recorded frame
+    void Reset(void);
+
+    void BeginFrame(void);
+
+    void EndFrame(void);
+
+    int NumFrames(void) const {
+        return frame_times.size();
+    }
+
+    inline void Add(ProfileStage stage, Uint64 elapsed) {
+        ticks[stage] += elapsed;
+    }
+
+    inline void Count(ProfileCounter counter, Uint64 n) {
+        counts[counter] += n;
+    }
+
+    // Mean of a counter over the recorded frames
+    double CounterMean(ProfileCounter counter) const;
+
+    // Table of mean, p50, p95, p99 and max for the frame, every stage and every counter
+    void Print(void) const;
+
+    // Write the same table as CSV, or as JSON if path ends in .json
+    bool Write(const char* path) const;
+};
+
+// Start of a timed stage, 0 without a profiler
+inline Uint64 ProfileStart(Profiler *profiler) {
+    return profiler ? SDL_GetPerformanceCounter() : 0;
+}
+
+// Charge the time since start to stage and return the end, which starts the next stage
+inline Uint64 ProfileLap(Profiler *profiler, ProfileStage stage, Uint64 start) {
+    if (profiler == NULL) {
+        return 0;
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+    profiler->Add(stage, now - start);
+    return now;
+}
@@ -0,0 +1,104 @@
+#include "rasterizer.h"
+#include <algorithm>
+
+//=============================================
+// Half-space rasterizer
+//=============================================
+
+bool HalfSpaceInRange(const RasterVertex *v, int n, int width, int height) {
+    // Extent of the polygon together with the screen
+    float min_x = 0.0;
+    float max_x = width;
+    float min_y = 0.0;
+    float max_y = height;
+    for (int k = 0; k < n; k++) {
+        min_x = std::min(min_x, v[k].x);
+        max_x = std::max(max_x, v[k].x);
+        min_y = std::min(min_y, v[k].y);
+        max_y = std::max(max_y, v[k].y);
+    }
+    return (max_x - min_x) < HALFSPACE_RANGE && (max_y - min_y) < HALFSPACE_RANGE;
+}
+
+bool TriangleSetup::Setup(const RasterVertex &v0, const RasterVertex &v1, const RasterVertex &v2, int attribs, int width, int height) {
+    const RasterVertex *v[3] = { &v0, &v1, &v2 };
+    const int one = 1 << SUBPIXEL_BITS;
+
+    // Snap vertices to fixed point
+    int fx[3], fy[3];
+    for (int k = 0; k < 3; k++) {
+        fx[k] = (int)round(v[k]->x * one);
+        fy[k] = (int)round(v[k]->y * one);
+    }
+
+    // Twice the signed area, flip to a consistent winding so inside is >= 0
+    long long area = (long long)(fx[1] - fx[0]) * (fy[2] - fy[0]) - (long long)(fx[2] - fx[0]) * (fy[1] - fy[0]);
+    if (area == 0) {
+        return false;
+    }
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(fx[1], fx[2]);
+        std::swap(fy[1], fy[2]);
+    }
+
+    // Bounding box of pixel centers, clamped to the screen
+    min_x = std::max(0, (*std::min_element(fx, fx + 3) + one - 1) >> SUBPIXEL_BITS);
+    min_y = std::max(0, (*std::min_element(fy, fy + 3) + one - 1) >> SUBPIXEL_BITS);
+    max_x = std::min(width - 1, *std::max_element(fx, fx + 3) >> SUBPIXEL_BITS);
+    max_y = std::min(height - 1, *std::max_element(fy, fy + 3) >> SUBPIXEL_BITS);
+    if (min_x > max_x || min_y > max_y) {
+        return false;
+    }
+
+    // Edge k runs from vertex k to k + 1:
+    // E(p) = (xj - xi) * (py - yi) - (yj - yi) * (px - xi)
+    for (int k = 0; k < 3; k++) {
+        int i = k;
+        int j = (k + 1) % 3;
+        int dx = fx[j] - fx[i];
+        int dy = fy[j] - fy[i];
+
+        // Top-left fill rule: pixels exactly on an edge belong to only one of
+        // the two triangles sharing it
+        bool top_left = dy > 0 || (dy == 0 && dx < 0);
+
+        long long origin = (long long)dx * (min_y * one - fy[i]) - (long long)dy * (min_x * one - fx[i]);
+        edge_origin[k] = (int)(origin - (top_left ? 0 : 1));
+        edge_dx[k] = -dy * one;
+        edge_dy[k] = dx * one;
+    }
+
+    // Planes through z and the attributes, using the snapped positions
+    float x0 = (float)fx[0] / one;
+    float y0 = (float)fy[0] / one;
+    float x1 = (float)fx[1] / one - x0;
+    float y1 = (float)fy[1] / one - y0;
+    float x2 = (float)fx[2] / one - x0;
+    float y2 = (float)fy[2] / one - y0;
+    float inv_area = 1.0 / (x1 * y2 - x2 * y1);
+
+    for (int k = 0; k <= attribs; k++) {
+        float a[3];
+        for (int n = 0; n < 3; n++) {
+            if (k == 0) {
+                a[n] = v[n]->z;
+            }
+            else if (k <= 3) {
+                a[n] = v[n]->vec[k - 1];
+            }
+            else {
+                a[n] = v[n]->vert[k - 4];
+            }
+        }
+        float da1 = a[1] - a[0];
+        float da2 = a[2] - a[0];
+        float dadx = (da1 * y2 - da2 * y1) * inv_area;
+        float dady = (da2 * x1 - da1 * x2) * inv_area;
+        plane[k][0] = a[0] - dadx * x0 - dady * y0;
+        plane[k][1] = dadx;
+        plane[k][2] = dady;
+    }
+
+    return true;
+}
@@ -0,0 +1,501 @@
+#pragma once
+#include "vec3.h"
+#include "utils.h"
+#include "constants.h"
+#include "edgetable.h"
+#include "depthbuffer.h"
+#include <assert.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Both rasterizers take a polygon of RasterVerts and call
+// fragment(x, y, z, vec, vert, dvert) for every pixel inside clip that passes
+// the depth test, after the new depth has been written. ATTRIBS is the number
+// of interpolated floats the fragment uses: 0 (none), 3 (vec) or 6 (vec, vert).
+// dvert is the change in vert per pixel along the span, for texture level of
+// detail, and is zero unless ATTRIBS is 6.
+// A pixel gets the same values whatever the clip rectangle, so a polygon can
+// be drawn in pieces (one per screen tile) with the same result.
+// Vertices may lie off screen, within the guard band of clip.h, and only
+// pixels on screen are drawn.
+// Polygons and long spans entirely behind the depth buffer's max depth
+// pyramid are rejected before any per-pixel test.
+
+//================================
+// RasterVertex
+//================================
+
+class RasterVertex {
+public:
+    float x;        // screen x
+    float y;        // screen y
+    float z;        // depth
+    vec3 vec;       // norm or intensity
+    vec3 vert;      // vertex position
+};
+
+//================================
+// ClipRect
+//================================
+
+// Inclusive rectangle of pixels the rasterizers may write
+class ClipRect {
+public:
+    int x0, y0;
+    int x1, y1;
+
+public:
+    ClipRect() : x0(0), y0(0), x1(SCREEN_WIDTH - 1), y1(SCREEN_HEIGHT - 1) {
+    }
+
+    ClipRect(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {
+    }
+};
+
+//================================
+// RasterCounts
+//================================
+
+// Work done by the rasterizers, accumulated until reset by the caller
+class RasterCounts {
+public:
+    Uint64 polygons;    // polygons scan converted, after the whole polygon occlusion test
+    Uint64 tested;      // pixels inside polygons that reached the depth test
+    Uint64 written;     // pixels that passed the depth test
+
+public:
+    RasterCounts() : polygons(0), tested(0), written(0) {
+    }
+};
+
+//================================
+// RasterContext
+//================================
+
+// Scratch space for rasterizing one polygon at a time.
+// Reused between polygons, one per thread.
+class RasterContext {
+public:
+    EdgeTable edge_table;
+    ActiveEdgeTable active_edges;
+    std::vector< RasterVertex > face_verts;   // polygon being rasterized
+    RasterCounts counts;
+};
+
+//================================
+// Scanline rasterizer
+//================================
+
+// Add an edge starting on scanline y, stepped down to the first scanline
+// if it starts above the screen
+template <int ATTRIBS>
+inline void InsertScanlineEdge(EdgeTable &et, int y, Edge &e) {
+    if (y < 0) {
+        if (e.y_max <= 0) {
+            return;
+        }
+        float dy = -y;
+        e.x_min += e.inv_m * dy;
+        e.z_min += e.del_z * dy;
+        if (ATTRIBS >= 3) {
+            e.vec_min = e.vec_min + dy * e.del_vec;
+        }
+        if (ATTRIBS >= 6) {
+            e.vert_min = e.vert_min + dy * e.del_vert;
+        }
+        y = 0;
+    }
+    et.InsertEdge(y, e);
+}
+
+// Fill a convex polygon with the edge table / active edge table algorithm
+template <int ATTRIBS, typename Fragment>
+void ScanlinePolygon(const RasterVertex *v, int n, EdgeTable &et, ActiveEdgeTable &aet, const ClipRect &clip, DepthBuffer &depth, RasterCounts &counts, Fragment fragment) {
+    if ((int)et.buckets.size() != depth.height) {
+        et.Resize(depth.height);
+    }
+    et.Clear();
+    // For each edge in face
+    for (int k = 0; k < n; k++) {
+        const RasterVertex &p0 = v[k];
+        const RasterVertex &p1 = v[(k + 1) % n];
+
+        float x0 = p0.x;
+        float x1 = p1.x;
+        float y0 = p0.y;
+        float y1 = p1.y;
+        float z0 = p0.z;
+        float z1 = p1.z;
+
+        // Round points 0 and 1
+        int iy0 = (int)round(y0);
+        int iy1 = (int)round(y1);
+
+        float inv_m = (x1 - x0)/(y1 - y0);
+
+        // Add only non-horizontal edges to ET
+        if (iy0 == iy1) {
+            continue;
+        }
+
+        // Assume convex polygon - don't shorten edges
+
+        // Add to edge table
+        if (iy0 < iy1) {
+            // p0 is lower than p1
+            Edge e(iy1, x0, inv_m, z0, (z1-z0)/(y1-y0));
+            if (ATTRIBS >= 3) {
+                e.vec_min = p0.vec;
+                e.del_vec = (1.0/(y1-y0))*(p1.vec - p0.vec);
+            }
+            if (ATTRIBS >= 6) {
+                e.vert_min = p0.vert;
+                e.del_vert = (1.0/(y1-y0))*(p1.vert - p0.vert);
+            }
+            InsertScanlineEdge<ATTRIBS>(et, iy0, e);
+        }
+        else {
+            // p1 is lower than p0
+            Edge e(iy0, x1, inv_m, z1, (z0-z1)/(y0-y1));
+            if (ATTRIBS >= 3) {
+                e.vec_min = p1.vec;
+                e.del_vec = (1.0/(y0-y1))*(p0.vec - p1.vec);
+            }
+            if (ATTRIBS >= 6) {
+                e.vert_min = p1.vert;
+                e.del_vert = (1.0/(y0-y1))*(p0.vert - p1.vert);
+            }
+            InsertScanlineEdge<ATTRIBS>(et, iy1, e);
+        }
+    }
+
+    // Create active edge table
+    aet.Clear();
+
+    // Start at the first scanline containing an edge
+    // Stop when ET and AET are empty
+    // Stop after the last scanline in clip
+    for (int y = et.FirstScanline(); (!et.IsEmpty() || !aet.IsEmpty()) && y < depth.height && y <= clip.y1; y++) {
+        // Move edges from ET to AET
+        Edge* e;
+        while((e = et.RemoveEdge(y)) != nullptr) {
+            // AET is keyed by x_int
+            int x_int = (int)round(e->x_min);
+            aet.InsertEdge(x_int, e);
+        }
+
+        // Draw lines between pairs of edges in AET
+        // Edges are still stepped on scanlines above clip so x stays the same
+        assert(aet.edges.size() % 2 == 0);
+        for (size_t j = 0; j < aet.edges.size() && y >= clip.y0; j += 2) {
+            Edge *e0 = aet.edges[j];
+            Edge *e1 = aet.edges[j + 1];
+            int ix0 = e0->x_int;
+            int ix1 = e1->x_int;
+
+            // Fill in points between and including edges
+            float z0 = e0->z_min;
+            float z1 = e1->z_min;
+            float hor_del_z = ix1 > ix0 ? (z1 - z0)/(ix1 - ix0) : 0.0f;
+
+            // Interpolate attributes horizontally
+            vec3 hor_del_vec, hor_del_vert;
+            if (ATTRIBS >= 3 && ix1 > ix0) {
+                hor_del_vec = (1.0/(ix1 - ix0))*(e1->vec_min - e0->vec_min);
+            }
+            if (ATTRIBS >= 6 && ix1 > ix0) {
+                hor_del_vert = (1.0/(ix1 - ix0))*(e1->vert_min - e0->vert_min);
+            }
+
+            // Values are evaluated from the distance to the left edge, not
+            // accumulated, so the span can start at the clip edge
+            int x_start = std::max(ix0, clip.x0);
+            int x_end = std::min(ix1, clip.x1);
+
+            // Skip long spans that are behind everything already drawn
+            if (x_end - x_start >= DEPTH_SPAN) {
+                float z_near = std::min(z0 + (x_start - ix0) * hor_del_z, z0 + (x_end - ix0) * hor_del_z);
+                if (depth.Occluded(x_start, y, x_end, y, z_near - DEPTH_MARGIN, false)) {
+                    continue;
+                }
+            }
+
+            float *row = depth.Row(y);
+            counts.tested += std::max(x_end - x_start + 1, 0);
+            for (int x = x_start; x <= x_end; x++) {
+                float t = x - ix0;
+                float z = z0 + t * hor_del_z;
+
+                // Only draw point if point is in front of current z value
+                if (comparefloats(z, row[x], FLOAT_TOL) == -1) {
+                    depth.Set(x, y, z);
+                    counts.written++;
+
+                    vec3 vec, vert;
+                    if (ATTRIBS >= 3) {
+                        vec = e0->vec_min + t * hor_del_vec;
+                    }
+                    if (ATTRIBS >= 6) {
+                        vert = e0->vert_min + t * hor_del_vert;
+                    }
+                    fragment(x, y, z, vec, vert, hor_del_vert);
+                }
+            }
+        }
+
+        // Update edges
+        aet.UpdateEdges<ATTRIBS>(y);
+    }
+}
+
+//================================
+// Half-space rasterizer
+//================================
+
+// Pixels tested per iteration
+#if defined(__AVX2__)
+#define RASTER_LANES 8
+#elif defined(__SSE2__)
+#define RASTER_LANES 4
+#else
+#define RASTER_LANES 1
+#endif
+
+// Bits of sub-pixel precision in the integer edge functions
+#define SUBPIXEL_BITS 4
+
+// Polygons whose extent, together with the screen, is larger than this many
+// pixels fall back to the scanline rasterizer so edge functions fit in 32 bits
+#define HALFSPACE_RANGE 2040
+
+// Integer edge functions and interpolation planes of one triangle.
+// Edge functions are exact integers and planes are evaluated from absolute
+// pixel coordinates, so a pixel gets the same result however the bounding
+// box is walked.
+class TriangleSetup {
+public:
+    int min_x, min_y;       // bounding box clamped to the screen
+    int max_x, max_y;
+    int edge_origin[3];     // edge function at pixel (min_x, min_y)
+    int edge_dx[3];         // edge function step per pixel in x
+    int edge_dy[3];         // edge function step per pixel in y
+    float plane[7][3];      // z and attributes: value = p[0] + p[1] * x + p[2] * y
+
+public:
+    // Returns false if the triangle covers no pixels of a width x height screen
+    bool Setup(const RasterVertex &v0, const RasterVertex &v1, const RasterVertex &v2, int attribs, int width, int height);
+};
+
+// True if every vertex is close enough to a width x height screen for fixed point edge functions
+bool HalfSpaceInRange(const RasterVertex *v, int n, int width, int height);
+
+template <int ATTRIBS, typename Fragment>
+void HalfSpaceTriangle(const TriangleSetup &t, const ClipRect &clip, DepthBuffer &depth, RasterCounts &counts, Fragment fragment) {
+    const int LANES = RASTER_LANES;
+    const int FLOATS = ATTRIBS + 1;     // z followed by attributes
+
+    vec3 dvert;
+    if (ATTRIBS >= 6) {
+        dvert = vec3(t.plane[4][1], t.plane[5][1], t.plane[6][1]);
+    }
+
+    int y_start = std::max(t.min_y, clip.y0);
+    int y_end = std::min(t.max_y, clip.y1);
+    for (int y = y_start; y <= y_end; y++) {
+        // Edge functions at the start of the row
+        int row_edge[3];
+        for (int k = 0; k < 3; k++) {
+            row_edge[k] = t.edge_origin[k] + t.edge_dy[k] * (y - t.min_y);
+        }
+
+        // Narrow the row to the span where every edge function can be >= 0
+        int span_min = std::max(t.min_x, clip.x0);
+        int span_max = std::min(t.max_x, clip.x1);
+        for (int k = 0; k < 3; k++) {
+            int e = row_edge[k];
+            int d = t.edge_dx[k];
+            if (d > 0 && e < 0) {
+                span_min = std::max(span_min, t.min_x + (-e + d - 1) / d);
+            }
+            else if (d < 0 && e >= 0) {
+                span_max = std::min(span_max, t.min_x + e / -d);
+            }
+            else if (d <= 0 && e < 0) {
+                span_max = -1;
+            }
+        }
+        if (span_min > span_max) {
+            continue;
+        }
+
+        float row_plane[FLOATS];
+        for (int k = 0; k < FLOATS; k++) {
+            row_plane[k] = t.plane[k][0] + t.plane[k][2] * y;
+        }
+
+        // Skip long spans that are behind everything already drawn
+        if (span_max - span_min >= DEPTH_SPAN) {
+            float z_near = std::min(row_plane[0] + t.plane[0][1] * span_min, row_plane[0] + t.plane[0][1] * span_max);
+            if (depth.Occluded(span_min, y, span_max, y, z_near - DEPTH_MARGIN, false)) {
+                continue;
+            }
+        }
+        const float *row = depth.Row(y);
+
+        // Start blocks on a multiple of LANES so loads stay aligned to the row
+        int start_x = span_min - (span_min % LANES);
+
+        for (int x = start_x; x <= span_max; x += LANES) {
+            // Mask of lanes inside the span
+            int lanes = span_max - x + 1;
+            int box_mask = lanes >= LANES ? (1 << LANES) - 1 : (1 << lanes) - 1;
+            if (x < span_min) {
+                box_mask &= ~((1 << (span_min - x)) - 1);
+            }
+
+            float values[FLOATS][LANES];
+            int mask;
+
+            #if RASTER_LANES == 8
+            const __m256i lane_i = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            __m256 xs = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), lane_i));
+            // Coverage: a pixel is inside when all three edge functions are >= 0
+            __m256i inside = _mm256_setzero_si256();
+            for (int k = 0; k < 3; k++) {
+                __m256i w = _mm256_add_epi32(_mm256_set1_epi32(row_edge[k] + t.edge_dx[k] * (x - t.min_x)), _mm256_mullo_epi32(_mm256_set1_epi32(t.edge_dx[k]), lane_i));
+                inside = _mm256_or_si256(inside, w);
+            }
+            mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(inside)) & box_mask;
+            if (mask == 0) {
+                continue;
+            }
+            counts.tested += __builtin_popcount(mask);
+            // Depth test against the z buffer: drawn when z is in front by more than FLOAT_TOL
+            for (int k = 0; k < FLOATS; k++) {
+                __m256 value = _mm256_add_ps(_mm256_set1_ps(row_plane[k]), _mm256_mul_ps(_mm256_set1_ps(t.plane[k][1]), xs));
+                _mm256_storeu_ps(values[k], value);
+            }
+            // Rows are padded so the load may run past the end of the row
+            __m256 front = _mm256_cmp_ps(_mm256_sub_ps(_mm256_loadu_ps(row + x), _mm256_loadu_ps(values[0])), _mm256_set1_ps(FLOAT_TOL), _CMP_GE_OQ);
+            mask &= _mm256_movemask_ps(front);
+            #elif RASTER_LANES == 4
+            const __m128 lane_f = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            __m128 xs = _mm_add_ps(_mm_set1_ps((float)x), lane_f);
+            // Coverage: a pixel is inside when all three edge functions are >= 0
+            __m128i inside = _mm_setzero_si128();
+            for (int k = 0; k < 3; k++) {
+                int w0 = row_edge[k] + t.edge_dx[k] * (x - t.min_x);
+                int dx = t.edge_dx[k];
+                __m128i w = _mm_setr_epi32(w0, w0 + dx, w0 + 2 * dx, w0 + 3 * dx);
+                inside = _mm_or_si128(inside, w);
+            }
+            mask = ~_mm_movemask_ps(_mm_castsi128_ps(inside)) & box_mask;
+            if (mask == 0) {
+                continue;
+            }
+            counts.tested += __builtin_popcount(mask);
+            // Depth test against the z buffer: drawn when z is in front by more than FLOAT_TOL
+            for (int k = 0; k < FLOATS; k++) {
+                __m128 value = _mm_add_ps(_mm_set1_ps(row_plane[k]), _mm_mul_ps(_mm_set1_ps(t.plane[k][1]), xs));
+                _mm_storeu_ps(values[k], value);
+            }
+            // Rows are padded so the load may run past the end of the row
+            __m128 front = _mm_cmpge_ps(_mm_sub_ps(_mm_loadu_ps(row + x), _mm_loadu_ps(values[0])), _mm_set1_ps(FLOAT_TOL));
+            mask &= _mm_movemask_ps(front);
+            #else
+            int inside = 0;
+            for (int k = 0; k < 3; k++) {
+                inside |= row_edge[k] + t.edge_dx[k] * (x - t.min_x);
+            }
+            mask = (inside >= 0 ? 1 : 0) & box_mask;
+            if (mask == 0) {
+                continue;
+            }
+            counts.tested += __builtin_popcount(mask);
+            for (int k = 0; k < FLOATS; k++) {
+                values[k][0] = row_plane[k] + t.plane[k][1] * (float)x;
+            }
+            if (!(row[x] - values[0][0] >= FLOAT_TOL)) {
+                mask = 0;
+            }
+            #endif
+
+            // Shade the pixels that passed
+            counts.written += __builtin_popcount(mask);
+            while (mask != 0) {
+                int i = __builtin_ctz(mask);
+                mask &= mask - 1;
+
+                float z = values[0][i];
+                depth.Set(x + i, y, z);
+
+                vec3 vec, vert;
+                if (ATTRIBS >= 3) {
+                    vec = vec3(values[1][i], values[2][i], values[3][i]);
+                }
+                if (ATTRIBS >= 6) {
+                    vert = vec3(values[4][i], values[5][i], values[6][i]);
+                }
+                fragment(x + i, y, z, vec, vert, dvert);
+            }
+        }
+    }
+}
+
+//================================
+// Polygon
+//================================
+
+// Rasterize the convex polygon in context.face_verts with the selected rasterizer.
+// The half-space rasterizer splits the polygon into a triangle fan.
+template <int ATTRIBS, typename Fragment>
+void FillPolygon(RasterType raster_type, RasterContext &context, const ClipRect &clip, DepthBuffer &depth, Fragment fragment) {
+    const RasterVertex *v = context.face_verts.data();
+    int n = context.face_verts.size();
+    if (n < 3) {
+        return;
+    }
+
+    // Skip large polygons that are behind everything already drawn in their bounding box
+    float min_x = v[0].x, max_x = v[0].x;
+    float min_y = v[0].y, max_y = v[0].y;
+    float z_near = v[0].z;
+    for (int k = 1; k < n; k++) {
+        min_x = std::min(min_x, v[k].x);
+        max_x = std::max(max_x, v[k].x);
+        min_y = std::min(min_y, v[k].y);
+        max_y = std::max(max_y, v[k].y);
+        z_near = std::min(z_near, v[k].z);
+    }
+    int x0 = (int)std::max(floorf(min_x), (float)clip.x0);
+    int y0 = (int)std::max(floorf(min_y), (float)clip.y0);
+    int x1 = (int)std::min(ceilf(max_x), (float)clip.x1);
+    int y1 = (int)std::min(ceilf(max_y), (float)clip.y1);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+    bool large = (x1 - x0 + 1) * (y1 - y0 + 1) >= DEPTH_POLYGON_AREA;
+    if (large && depth.Occluded(x0, y0, x1, y1, z_near - DEPTH_MARGIN, true)) {
+        return;
+    }
+    context.counts.polygons++;
+
+    if (raster_type == HALFSPACE && HalfSpaceInRange(v, n, depth.width, depth.height)) {
+        for (int k = 1; k + 1 < n; k++) {
+            TriangleSetup t;
+            if (t.Setup(v[0], v[k], v[k + 1], ATTRIBS, depth.width, depth.height)) {
+                HalfSpaceTriangle<ATTRIBS>(t, clip, depth, context.counts, fragment);
+            }
+        }
+    }
+    else {
+        ScanlinePolygon<ATTRIBS>(v, n, context.edge_table, context.active_edges, clip, depth, context.counts, fragment);
+    }
+    depth.MarkDirty(x0, y0, x1, y1);
+}
@@ -0,0 +1,181 @@
+#include "scene.h"
+#include <algorithm>
+
+void Scene::Clear(void)
+{
+    instances.clear();
+    instance_min.clear();
+    instance_max.clear();
+    nodes.clear();
+    order.clear();
+    leaves.clear();
+    moved.clear();
+    is_moved.clear();
+}
+
+int Scene::Add(const Instance &instance)
+{
+    int index = instances.size();
+    instances.push_back(instance);
+    instances[index].scene = this;
+    instances[index].scene_index = index;
+    nodes.clear();
+    return index;
+}
+
+void Scene::Moved(int index)
+{
+    if (nodes.empty() || is_moved[index]) {
+        return;
+    }
+    is_moved[index] = true;
+    moved.push_back(index);
+}
+
+void Scene::Bound(int i)
+{
+    const Instance &instance = instances[i];
+    instance.mesh->WorldBounds(instance.ModelMatrix(), instance_min[i], instance_max[i]);
+}
+
+bool Scene::BoundNode(int node)
+{
+    SceneNode &n = nodes[node];
+    vec3 min, max;
+    if (n.left < 0) {
+        min = instance_min[order[n.first]];
+        max = instance_max[order[n.first]];
+        for (int k = n.first + 1; k < n.first + n.count; k++) {
+            const vec3 &a = instance_min[order[k]];
+            const vec3 &b = instance_max[order[k]];
+            min = vec3(std::min(min.x, a.x), std::min(min.y, a.y), std::min(min.z, a.z));
+            max = vec3(std::max(max.x, b.x), std::max(max.y, b.y), std::max(max.z, b.z));
+        }
+    }
+    else {
+        const SceneNode &l = nodes[n.left];
+        const SceneNode &r = nodes[n.left + 1];
+        min = vec3(std::min(l.min.x, r.min.x), std::min(l.min.y, r.min.y), std::min(l.min.z, r.min.z));
+        max = vec3(std::max(l.max.x, r.max.x), std::max(l.max.y, r.max.y), std::max(l.max.z, r.max.z));
+    }
+    bool changed = min.x != n.min.x || min.y != n.min.y || min.z != n.min.z
+        || max.x != n.max.x || max.y != n.max.y || max.z != n.max.z;
+    n.min = min;
+    n.max = max;
+    return changed;
+}
+
+void Scene::BuildNode(int node, int first, int count, int parent)
+{
+    nodes[node].first = first;
+    nodes[node].count = count;
+    nodes[node].left = -1;
+    nodes[node].parent = parent;
+    if (count <= SCENE_LEAF_SIZE) {
+        for (int k = first; k < first + count; k++) {
+            leaves[order[k]] = node;
+        }
+        BoundNode(node);
+        return;
+    }
+
+    // Split at the median center along the axis the centers spread most
+    vec3 min = instance_min[order[first]] + instance_max[order[first]];
+    vec3 max = min;
+    for (int k = first + 1; k < first + count; k++) {
+        vec3 c = instance_min[order[k]] + instance_max[order[k]];
+        min = vec3(std::min(min.x, c.x), std::min(min.y, c.y), std::min(min.z, c.z));
+        max = vec3(std::max(max.x, c.x), std::max(max.y, c.y), std::max(max.z, c.z));
+    }
+    vec3 size = max - min;
+    int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](int a, int b) {
+        return instance_min[a][axis] + instance_max[a][axis] < instance_min[b][axis] + instance_max[b][axis];
+    });
+
+    // Children are allocated together, so the second is always left + 1
+    int left = nodes.size();
+    nodes.resize(left + 2);
+    nodes[node].left = left;
+    BuildNode(left, first, half, node);
+    BuildNode(left + 1, first + half, count - half, node);
+    BoundNode(node);
+}
+
+void Scene::Build(void)
+{
+    int count = instances.size();
+    instance_min.resize(count);
+    instance_max.resize(count);
+    for (int i = 0; i < count; i++) {
+        Bound(i);
+    }
+    order.resize(count);
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    leaves.assign(count, -1);
+    moved.clear();
+    is_moved.assign(count, false);
+
+    nodes.clear();
+    if (count > 0) {
+        nodes.reserve(2 * count / SCENE_LEAF_SIZE + 1);
+        nodes.resize(1);
+        BuildNode(0, 0, count, -1);
+    }
+}
+
+void Scene::Refit(void)
+{
+    if (nodes.empty()) {
+        Build();
+        return;
+    }
+
+    // Ancestors only change while their child did
+    for (int i : moved) {
+        is_moved[i] = false;
+        Bound(i);
+        int node = leaves[i];
+        while (node >= 0 && BoundNode(node)) {
+            node = nodes[node].parent;
+        }
+    }
+    moved.clear();
+}
+
+void Scene::Query(const Frustum &frustum, std::vector< Instance* > &visible)
+{
+    Refit();
+    size_t start = visible.size();
+    if (!nodes.empty()) {
+        stack.assign(1, 0);
+    }
+    while (!stack.empty()) {
+        const SceneNode &n = nodes[stack.back()];
+        stack.pop_back();
+        FrustumTest test = frustum.TestBox(n.min, n.max);
+        if (test == FRUSTUM_OUTSIDE) {
+            continue;
+        }
+
+        // Everything below a node inside the frustum is too, no need to test further
+        if (test == FRUSTUM_INSIDE || n.left < 0) {
+            for (int k = n.first; k < n.first + n.count; k++) {
+                int i = order[k];
+                const Instance &instance = instances[i];
+                if (test == FRUSTUM_INSIDE || instance.mesh->TestFrustum(instance.ModelMatrix(), frustum) != FRUSTUM_OUTSIDE) {
+                    visible.push_back(&instances[i]);
+                }
+            }
+            continue;
+        }
+        stack.push_back(n.left + 1);
+        stack.push_back(n.left);
+    }
+
+    // Draw order doesn't depend on the shape of the hierarchy
+    std::sort(visible.begin() + start, visible.end());
+}
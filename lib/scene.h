@@ -0,0 +1,87 @@
+#pragma once
+#include "vec3.h"
+#include "camera.h"
+#include "model.h"
+#include <vector>
+
+//================================
+// Scene
+//================================
+
+// Most instances in a leaf of the hierarchy
+#define SCENE_LEAF_SIZE 4
+
+// Node of the bounding volume hierarchy, covering the instances
+// order[first] to order[first + count - 1]
+class SceneNode {
+public:
+    vec3 min;               // world bounds of every instance below
+    vec3 max;
+    int first;
+    int count;
+    int left;               // first child, the second follows it, -1 for leaves
+    int parent;             // -1 for the root
+};
+
+// Instances organized in a bounding volume hierarchy of their world space
+// boxes, so a frustum query only visits the parts of the scene near the
+// view. Transforming an instance marks it moved, and the next query
+// refits its leaf and the nodes above it instead of rebuilding.
+class Scene {
+public:
+    std::vector< Instance > instances;      // each points back at the scene, so the scene must not be copied
+    std::vector< vec3 > instance_min;       // world bounds of each instance at the last refit
+    std::vector< vec3 > instance_max;
+    std::vector< SceneNode > nodes;         // nodes[0] is the root, empty until built
+    std::vector< int > order;               // instance indices, each node's contiguous
+    std::vector< int > leaves;              // leaf of each instance
+    std::vector< int > moved;               // instances transformed since the last refit
+    std::vector< bool > is_moved;
+    std::vector< int > stack;               // traversal scratch
+
+public:
+    Scene() {
+    }
+
+    ~Scene() {
+    }
+
+    Scene(const Scene&) = delete;
+
+    Scene& operator=(const Scene&) = delete;
+
+    int NumInstances(void) const {
+        return instances.size();
+    }
+
+    void Clear(void);
+
+    // Add a copy of instance and return its index. Moves the instances, so
+    // pointers to them are invalid, and the hierarchy is rebuilt by the next query.
+    int Add(const Instance &instance);
+
+    // Build the hierarchy over every instance from scratch, splitting at the
+    // median center along the longest axis
+    void Build(void);
+
+    // Mark instance index moved, called by Instance when its transform changes
+    void Moved(int index);
+
+    // Update the bounds of moved instances and of the nodes above them
+    void Refit(void);
+
+    // Refit, then append to visible every instance whose mesh bounds are not
+    // entirely outside frustum, in index order. The only instance cull, Render
+    // draws whatever it is given.
+    void Query(const Frustum &frustum, std::vector< Instance* > &visible);
+
+private:
+    // Compute instance i's world bounds
+    void Bound(int i);
+
+    // Set the bounds of node from its instances or children, false if they did not change
+    bool BoundNode(int node);
+
+    // Make node cover order[first, first + count), splitting it until the leaves are small
+    void BuildNode(int node, int first, int count, int parent);
+};
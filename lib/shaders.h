@@ -0,0 +1,248 @@
+#pragma once
+#include "model.h"
+#include "mat4.h"
+#include "vec3.h"
+#include "camera.h"
+#include "constants.h"
+#include "illumination.h"
+#include "framebuffer.h"
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+
+// Shading policies for Model::Draw. Each policy states at compile time
+// what the pipeline must produce for it:
+//   ATTRIBS   interpolated floats: 0, 3 (vec) or 6 (vec, vert)
+//   NORMALS   the vertex stage transforms vertex normals
+//   VERTS     vert interpolates the object space position
+//   DEFERRED  shading costs enough that a deferred draw should store the
+//             inputs and shade each pixel once, instead of every fragment
+// Prepare runs once per frame after culling and returns the per vertex
+// values interpolated as vec (nullptr for none). Shade colors one pixel
+// and is inlined into the rasterizer's span loop. dvert is the change in
+// vert per pixel along the span, for texture level of detail.
+
+//================================
+// ShadeContext
+//================================
+
+// Per frame inputs shared by the shading policies
+class ShadeContext {
+public:
+    Model &model;
+    Camera &camera;
+    Light &light;
+    Material &material;
+    Framebuffer &framebuffer;
+    mat4 model_matrix;
+    vec3 view_direction;    // toward the camera from the model center
+    vec3 light_direction;   // toward the light from the model center
+
+public:
+    ShadeContext(Model &model, Camera &camera, Light &light, Material &material, Framebuffer &framebuffer)
+        : model(model), camera(camera), light(light), material(material), framebuffer(framebuffer), model_matrix(1) {
+    }
+};
+
+// Draw RGB scaled by intensity
+inline void SetIntensity(Framebuffer &framebuffer, int x, int y, const vec3 &intensity) {
+    Uint8 r = (Uint8)floor(abs(intensity.x) * 255.0);
+    Uint8 g = (Uint8)floor(abs(intensity.y) * 255.0);
+    Uint8 b = (Uint8)floor(abs(intensity.z) * 255.0);
+    framebuffer.SetPixel(x, y, r, g, b);
+}
+
+// Lighting model selected by MATERIAL_TYPE
+inline vec3 Illuminate(ShadeContext &c, const vec3 &normal) {
+    if (MATERIAL_TYPE == CARTOON) {
+        return c.material.CartoonIllumination(normal, c.light_direction);
+    }
+    return c.material.PhongIllumination(c.material.color, c.view_direction, normal, c.light_direction, c.light);
+}
+
+//================================
+// Shaders
+//================================
+
+// Constant random color per face
+class FacesShader {
+public:
+    static const int ATTRIBS = 0;
+    static const bool NORMALS = false;
+    static const bool VERTS = false;
+    static const bool DEFERRED = false;
+    const vec3 *colors;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        colors = c.model.mesh->face_colors.data();
+        return nullptr;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        const vec3 &color = colors[i];
+        c.framebuffer.SetPixel(x, y, (Uint8)color.x, (Uint8)color.y, (Uint8)color.z);
+    }
+};
+
+// Depth map
+class DepthShader {
+public:
+    static const int ATTRIBS = 0;
+    static const bool NORMALS = false;
+    static const bool VERTS = false;
+    static const bool DEFERRED = false;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        return nullptr;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        Uint8 shade = (Uint8)round(255 * ((z - 0.95) / 0.05));
+        c.framebuffer.SetPixel(x, y, shade, shade, shade);
+    }
+};
+
+// One lighting calculation per face
+class FlatShader {
+public:
+    static const int ATTRIBS = 0;
+    static const bool NORMALS = false;
+    static const bool VERTS = false;
+    static const bool DEFERRED = false;
+    const vec3 *shades;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        Model &m = c.model;
+        m.face_shades.resize(m.NumFaces());
+        for (size_t k = 0; k < m.visible_faces.size(); k++) {
+            int i = m.visible_faces[k];
+
+            // Calculate surface normal
+            const int *indices = m.FaceIndices(i);
+            vec3 v0 = m.screen_verts.world[indices[0]];
+            vec3 v1 = m.screen_verts.world[indices[1]];
+            vec3 v2 = m.screen_verts.world[indices[2]];
+            // Note: switching cross product A, B because of some weirdness with LH coordinate system
+            vec3 surface_normal = ((v0-v1).cross(v2-v1)).normalize();
+
+            vec3 intensity = Illuminate(c, surface_normal);
+            m.face_shades[i] = vec3(floor(abs(intensity.x) * 255.0), floor(abs(intensity.y) * 255.0), floor(abs(intensity.z) * 255.0));
+        }
+        shades = m.face_shades.data();
+        return nullptr;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        const vec3 &shade = shades[i];
+        c.framebuffer.SetPixel(x, y, (Uint8)shade.x, (Uint8)shade.y, (Uint8)shade.z);
+    }
+};
+
+// Lighting per vertex, intensity interpolated across each face
+class GouraudShader {
+public:
+    static const int ATTRIBS = 3;
+    static const bool NORMALS = true;
+    static const bool VERTS = false;
+    static const bool DEFERRED = false;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        ScreenVerts &sv = c.model.screen_verts;
+        sv.intensities.resize(c.model.mesh->verts.size());
+        for (size_t i = 0; i < sv.intensities.size(); i++) {
+            sv.intensities[i] = Illuminate(c, sv.normals[i]);
+        }
+        return &sv.intensities;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &intensity, const vec3 &vert, const vec3 &dvert) {
+        SetIntensity(c.framebuffer, x, y, intensity);
+    }
+};
+
+// Lighting per pixel from the interpolated vertex normal
+class PhongShader {
+public:
+    static const int ATTRIBS = 3;
+    static const bool NORMALS = true;
+    static const bool VERTS = false;
+    static const bool DEFERRED = true;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        return &c.model.screen_verts.normals;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        vec3 norm = vec;
+        norm.normalize();
+        SetIntensity(c.framebuffer, x, y, Illuminate(c, norm));
+    }
+};
+
+// RGB from the interpolated surface normal
+class NormalShader {
+public:
+    static const int ATTRIBS = 3;
+    static const bool NORMALS = true;
+    static const bool VERTS = false;
+    static const bool DEFERRED = false;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        return &c.model.screen_verts.normals;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        vec3 norm = vec;
+        norm.normalize();
+        SetIntensity(c.framebuffer, x, y, norm);
+    }
+};
+
+// Phong lighting of an environment cube map looked up by the surface normal
+class EnvironmentShader {
+public:
+    static const int ATTRIBS = 3;
+    static const bool NORMALS = true;
+    static const bool VERTS = false;
+    static const bool DEFERRED = true;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        return &c.model.screen_verts.normals;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        vec3 norm = vec;
+        norm.normalize();
+        vec3 texture = c.material.GetEnvironment(norm);
+        SetIntensity(c.framebuffer, x, y, c.material.PhongIllumination(texture, c.view_direction, norm, c.light_direction, c.light));
+    }
+};
+
+// Phong lighting of a texture looked up by the object space position
+class TextureShader {
+public:
+    static const int ATTRIBS = 6;
+    static const bool NORMALS = true;
+    static const bool VERTS = true;
+    static const bool DEFERRED = true;
+
+    const std::vector< vec3 >* Prepare(ShadeContext &c) {
+        return &c.model.screen_verts.normals;
+    }
+
+    inline void Shade(ShadeContext &c, int i, int x, int y, float z, const vec3 &vec, const vec3 &vert, const vec3 &dvert) {
+        vec3 norm = vec;
+        norm.normalize();
+        vec3 position = vert;
+        position.normalize();
+        // Angle the direction to the surface turns through per pixel along the span
+        float angle = 0.0f;
+        if (TEXTURE_FILTER == TEXTURE_TRILINEAR) {
+            vec3 step = dvert - position.dot(dvert) * position;
+            float length2 = vert.dot(vert);
+            angle = length2 > 0 ? sqrtf(step.dot(step) / length2) : 0.0f;
+        }
+        vec3 texture = c.material.GetTexture(position, angle);
+        SetIntensity(c.framebuffer, x, y, c.material.PhongIllumination(texture, c.view_direction, norm, c.light_direction, c.light));
+    }
+};
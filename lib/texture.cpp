@@ -0,0 +1,267 @@
+#define _USE_MATH_DEFINES
+
+#include "texture.h"
+#include <stdio.h>
+#include <assert.h>
+#include <cmath>
+#include <string.h>
+#include <algorithm>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//================================
+// TextureLevel
+//================================
+
+TextureLevel::TextureLevel() {
+    this->width = 0;
+    this->height = 0;
+    this->tiles_x = 0;
+}
+
+void TextureLevel::Create(int width, int height, const Uint32 *texels) {
+    this->width = width;
+    this->height = height;
+    tiles_x = (width + TEXTURE_TILE - 1) >> TEXTURE_TILE_SHIFT;
+    int tiles_y = (height + TEXTURE_TILE - 1) >> TEXTURE_TILE_SHIFT;
+    tiles.assign((size_t)tiles_x * tiles_y, TexelTile());
+
+    // Texels past the right and bottom edges repeat the last column and row
+    for (int y = 0; y < tiles_y * TEXTURE_TILE; y++) {
+        const Uint32 *row = texels + (size_t)std::min(y, height - 1) * width;
+        for (int x = 0; x < tiles_x * TEXTURE_TILE; x++) {
+            TexelTile &tile = tiles[(y >> TEXTURE_TILE_SHIFT) * tiles_x + (x >> TEXTURE_TILE_SHIFT)];
+            tile.texels[((y & (TEXTURE_TILE - 1)) << TEXTURE_TILE_SHIFT) + (x & (TEXTURE_TILE - 1))] = row[std::min(x, width - 1)];
+        }
+    }
+}
+
+//================================
+// Texture
+//================================
+
+Texture::Texture() {
+    this->width = 0;
+    this->height = 0;
+}
+
+bool Texture::Load(const char* path, bool mipmaps) {
+    SDL_Surface *image = IMG_Load(path);
+    if (image == NULL) {
+        printf("Unable to load image %s. SDL_image Error: %s\n", path, IMG_GetError());
+        return false;
+    }
+
+    // Whatever the file's pixel format, convert to 32 bit RGBA
+    SDL_Surface *surface = SDL_ConvertSurfaceFormat(image, TEXTURE_FORMAT, 0);
+    SDL_FreeSurface(image);
+    if (surface == NULL) {
+        printf("Unable to convert image %s. SDL Error: %s\n", path, SDL_GetError());
+        return false;
+    }
+
+    bool lock = SDL_MUSTLOCK(surface);
+    if (lock) {
+        SDL_LockSurface(surface);
+    }
+    std::vector< Uint32 > texels((size_t)surface->w * surface->h);
+    for (int y = 0; y < surface->h; y++) {
+        const Uint8 *row = (const Uint8*)surface->pixels + (size_t)y * surface->pitch;
+        memcpy(&texels[(size_t)y * surface->w], row, surface->w * sizeof(Uint32));
+    }
+    if (lock) {
+        SDL_UnlockSurface(surface);
+    }
+    Create(surface->w, surface->h, texels.data(), mipmaps);
+    SDL_FreeSurface(surface);
+    return true;
+}
+
+// Average of 2x2 texels per channel, rounded
+static Uint32 Average(Uint32 a, Uint32 b, Uint32 c, Uint32 d) {
+    Uint32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        Uint32 sum = ((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + ((c >> shift) & 0xFF) + ((d >> shift) & 0xFF);
+        result |= ((sum + 2) >> 2) << shift;
+    }
+    return result;
+}
+
+void Texture::Create(int width, int height, const Uint32 *texels, bool mipmaps) {
+    this->width = width;
+    this->height = height;
+    levels.clear();
+    levels.emplace_back();
+    levels.back().Create(width, height, texels);
+    if (!mipmaps) {
+        return;
+    }
+
+    // Box filter each level down to 1x1, odd sizes repeat their last column or row
+    std::vector< Uint32 > current(texels, texels + (size_t)width * height);
+    std::vector< Uint32 > next;
+    int w = width;
+    int h = height;
+    while (w > 1 || h > 1) {
+        int nw = std::max(w / 2, 1);
+        int nh = std::max(h / 2, 1);
+        next.resize((size_t)nw * nh);
+        for (int y = 0; y < nh; y++) {
+            const Uint32 *row0 = &current[(size_t)std::min(2 * y, h - 1) * w];
+            const Uint32 *row1 = &current[(size_t)std::min(2 * y + 1, h - 1) * w];
+            for (int x = 0; x < nw; x++) {
+                int x0 = std::min(2 * x, w - 1);
+                int x1 = std::min(2 * x + 1, w - 1);
+                next[(size_t)y * nw + x] = Average(row0[x0], row0[x1], row1[x0], row1[x1]);
+            }
+        }
+        levels.emplace_back();
+        levels.back().Create(nw, nh, next.data());
+        current.swap(next);
+        w = nw;
+        h = nh;
+    }
+}
+
+void EquirectCoords(const vec3 &dir, float &u, float &v) {
+    // Get a longitude wrapping eastward from x-, in the range 0-1.
+    u = 0.5 - atan2(dir.z, dir.x) / (2.0 * M_PI);
+    // Get a latitude wrapping northward from y-, in the range 0-1.
+    v = 0.5 + asin(dir.y) / M_PI;
+}
+
+Uint32 Texture::FetchEquirect(const vec3 &dir) const {
+    float longitude, latitude;
+    EquirectCoords(dir, longitude, latitude);
+
+    // Scale to integer between texture width and height
+    int x = (int)round((width - 1) * longitude);
+    int y = (int)round((height - 1) * latitude);
+    assert(x >= 0 && x < width);
+    assert(y >= 0 && y < height);
+    return Fetch(x, y);
+}
+
+// RGBA 0 to 255 from the 2x2 texels around (u, v)
+static inline void Bilinear(const TextureLevel &l, float u, float v, float rgba[4]) {
+    // Texel centers are at half integers
+    float x = u * l.width - 0.5f;
+    float y = std::min(std::max(v * l.height - 0.5f, 0.0f), (float)(l.height - 1));
+    float fx = floorf(x);
+    int x0 = (int)fx % l.width;
+    if (x0 < 0) {
+        x0 += l.width;
+    }
+    int x1 = x0 + 1 < l.width ? x0 + 1 : 0;
+    int y0 = (int)y;
+    int y1 = std::min(y0 + 1, l.height - 1);
+    float tx = x - fx;
+    float ty = y - y0;
+
+    Uint32 t00 = l.Fetch(x0, y0);
+    Uint32 t10 = l.Fetch(x1, y0);
+    Uint32 t01 = l.Fetch(x0, y1);
+    Uint32 t11 = l.Fetch(x1, y1);
+    #ifdef __SSE2__
+    // Widen the four texels' bytes to one float lane per channel
+    __m128i zero = _mm_setzero_si128();
+    __m128i texels = _mm_setr_epi32(t00, t10, t01, t11);
+    __m128i row0 = _mm_unpacklo_epi8(texels, zero);
+    __m128i row1 = _mm_unpackhi_epi8(texels, zero);
+    __m128 c00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(row0, zero));
+    __m128 c10 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(row0, zero));
+    __m128 c01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(row1, zero));
+    __m128 c11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(row1, zero));
+    __m128 wx = _mm_set1_ps(tx);
+    __m128 top = _mm_add_ps(c00, _mm_mul_ps(wx, _mm_sub_ps(c10, c00)));
+    __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(wx, _mm_sub_ps(c11, c01)));
+    _mm_storeu_ps(rgba, _mm_add_ps(top, _mm_mul_ps(_mm_set1_ps(ty), _mm_sub_ps(bottom, top))));
+    #else
+    for (int k = 0; k < 4; k++) {
+        int shift = 8 * k;
+        float top = ((t00 >> shift) & 0xFF) + tx * ((float)((t10 >> shift) & 0xFF) - ((t00 >> shift) & 0xFF));
+        float bottom = ((t01 >> shift) & 0xFF) + tx * ((float)((t11 >> shift) & 0xFF) - ((t01 >> shift) & 0xFF));
+        rgba[k] = top + ty * (bottom - top);
+    }
+    #endif
+}
+
+vec3 Texture::SampleBilinear(int level, float u, float v) const {
+    float rgba[4];
+    Bilinear(levels[level], u, v, rgba);
+    return vec3(rgba[0] / 256.0f, rgba[1] / 256.0f, rgba[2] / 256.0f);
+}
+
+vec3 Texture::SampleTrilinear(float u, float v, float lod) const {
+    int last = levels.size() - 1;
+    if (!(lod > 0)) {
+        return SampleBilinear(0, u, v);
+    }
+    if (lod >= last) {
+        return SampleBilinear(last, u, v);
+    }
+    int level = (int)lod;
+    float t = lod - level;
+    float a[4], b[4];
+    Bilinear(levels[level], u, v, a);
+    Bilinear(levels[level + 1], u, v, b);
+    return vec3((a[0] + t * (b[0] - a[0])) / 256.0f, (a[1] + t * (b[1] - a[1])) / 256.0f, (a[2] + t * (b[2] - a[2])) / 256.0f);
+}
+
+// log2 to within 0.01, plenty to pick and blend mip levels
+static inline float FastLog2(float x) {
+    Uint32 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float exponent = (float)((int)(bits >> 23) - 127);
+    bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    m -= 1.0f;
+    return exponent + m * (1.3465552f - 0.34655523f * m);
+}
+
+float Texture::EquirectLod(float angle) const {
+    // Texels per radian of longitude, the same as latitude for a 2:1 image
+    float texels = angle * width * (float)(0.5 / M_PI);
+    return texels > 0 ? FastLog2(texels) : 0.0f;
+}
+
+//================================
+// CubeMap
+//================================
+
+CubeMap::CubeMap() {
+    this->size = 0;
+}
+
+void CubeMap::Build(const Texture &equirect, int size) {
+    if (size <= 0) {
+        size = equirect.width / 4 > 0 ? equirect.width / 4 : 1;
+    }
+    this->size = size;
+
+    std::vector< Uint32 > texels((size_t)size * size);
+    for (int f = 0; f < 6; f++) {
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                // Texel center in [-1, 1] on the face, inverse of Fetch
+                float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+                float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+                vec3 dir;
+                switch (f) {
+                    case CUBE_POSITIVE_X: dir = vec3(1, -tc, -sc); break;
+                    case CUBE_NEGATIVE_X: dir = vec3(-1, -tc, sc); break;
+                    case CUBE_POSITIVE_Y: dir = vec3(sc, 1, tc); break;
+                    case CUBE_NEGATIVE_Y: dir = vec3(sc, -1, -tc); break;
+                    case CUBE_POSITIVE_Z: dir = vec3(sc, -tc, 1); break;
+                    default:              dir = vec3(-sc, -tc, -1); break;
+                }
+                texels[(size_t)y * size + x] = equirect.FetchEquirect(dir.normalize());
+            }
+        }
+        faces[f].Create(size, size, texels.data(), false);
+    }
+}
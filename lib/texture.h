@@ -0,0 +1,189 @@
+#pragma once
+#include "vec3.h"
+#include <SDL2/SDL.h>
+#include <cmath>
+#include <vector>
+
+//================================
+// Texture
+//================================
+
+// Texels are packed as 0xAABBGGRR, the same as the framebuffer
+#define TEXTURE_FORMAT SDL_PIXELFORMAT_ABGR8888
+
+// Texels per side of a storage tile. A 4x4 tile of RGBA8 is 64 bytes, one
+// cache line, so a bilinear footprint usually touches a single line.
+#define TEXTURE_TILE_SHIFT 2
+#define TEXTURE_TILE (1 << TEXTURE_TILE_SHIFT)
+
+// Sampling used by Material::GetTexture
+enum TextureFilter {
+    TEXTURE_NEAREST,        // nearest texel of the full size image
+    TEXTURE_BILINEAR,       // 2x2 texels of the full size image
+    TEXTURE_TRILINEAR,      // 2x2 texels of the two mip levels nearest the pixel footprint
+};
+#define TEXTURE_FILTER TEXTURE_TRILINEAR
+
+class alignas(64) TexelTile {
+public:
+    Uint32 texels[TEXTURE_TILE * TEXTURE_TILE];     // row-major within the tile
+};
+
+// One level of detail, stored as row-major tiles of row-major texels
+class TextureLevel {
+public:
+    int width;
+    int height;
+    int tiles_x;
+    std::vector< TexelTile > tiles;
+
+public:
+    TextureLevel();
+
+    // Copy a row-major image into tiles
+    void Create(int width, int height, const Uint32 *texels);
+
+    // (x, y) must be inside the level
+    inline Uint32 Fetch(int x, int y) const {
+        const TexelTile &tile = tiles[(y >> TEXTURE_TILE_SHIFT) * tiles_x + (x >> TEXTURE_TILE_SHIFT)];
+        return tile.texels[((y & (TEXTURE_TILE - 1)) << TEXTURE_TILE_SHIFT) + (x & (TEXTURE_TILE - 1))];
+    }
+};
+
+// Image decoded once at load time into texel arrays owned by the renderer,
+// with a mip chain down to 1x1. Fetching a texel is a plain indexed load: no
+// SDL call and no surface lock, so any number of threads can sample at once.
+// Sampling coordinates u and v run from 0 to 1 across the image, u wraps
+// around (longitude) and v is clamped.
+class Texture {
+public:
+    int width;                              // size of level 0
+    int height;
+    std::vector< TextureLevel > levels;     // level 0 is full size, each next level half
+
+public:
+    Texture();
+
+    // Load an image with SDL_image. The surface is freed once decoded.
+    bool Load(const char* path, bool mipmaps = true);
+
+    // Build from a row-major RGBA8 image
+    void Create(int width, int height, const Uint32 *texels, bool mipmaps);
+
+    bool Empty(void) const {
+        return levels.empty();
+    }
+
+    int NumLevels(void) const {
+        return levels.size();
+    }
+
+    // (x, y) must be inside the texture
+    inline Uint32 Fetch(int x, int y) const {
+        return levels[0].Fetch(x, y);
+    }
+
+    // Nearest texel of an equirectangular (latitude longitude) image in
+    // the direction of the unit vector dir
+    Uint32 FetchEquirect(const vec3 &dir) const;
+
+    // RGB intensity 0 to 1 from the 2x2 texels around (u, v) in one level
+    vec3 SampleBilinear(int level, float u, float v) const;
+
+    // Blend of the two levels around lod, level 0 when lod <= 0
+    vec3 SampleTrilinear(float u, float v, float lod) const;
+
+    // Level of detail for a pixel that spans angle radians of an equirectangular image
+    float EquirectLod(float angle) const;
+};
+
+// Equirectangular coordinates of the unit vector dir: longitude wrapping
+// eastward from x- and latitude northward from y-, both 0 to 1
+void EquirectCoords(const vec3 &dir, float &u, float &v);
+
+inline Uint8 TexelR(Uint32 texel) { return texel & 0xFF; }
+inline Uint8 TexelG(Uint32 texel) { return (texel >> 8) & 0xFF; }
+inline Uint8 TexelB(Uint32 texel) { return (texel >> 16) & 0xFF; }
+inline Uint8 TexelA(Uint32 texel) { return texel >> 24; }
+
+// RGB intensity 0 to 1
+inline vec3 TexelColor(Uint32 texel) {
+    return vec3((float)TexelR(texel) / 256.0, (float)TexelG(texel) / 256.0, (float)TexelB(texel) / 256.0);
+}
+
+//================================
+// CubeMap
+//================================
+
+// Texels per cube face side, 0 for a quarter of the equirectangular width
+// so the cube keeps the source resolution around the equator
+#define CUBEMAP_SIZE 0
+
+// Faces in OpenGL order, each stored as a size * size Texture
+enum CubeFace {
+    CUBE_POSITIVE_X,
+    CUBE_NEGATIVE_X,
+    CUBE_POSITIVE_Y,
+    CUBE_NEGATIVE_Y,
+    CUBE_POSITIVE_Z,
+    CUBE_NEGATIVE_Z,
+};
+
+// Environment map resampled once from an equirectangular image. A lookup
+// selects the face from the major axis of the direction and projects onto
+// it with one divide, no trigonometry.
+class CubeMap {
+public:
+    int size;
+    Texture faces[6];
+
+public:
+    CubeMap();
+
+    // Resample an equirectangular texture, size 0 picks CUBEMAP_SIZE
+    void Build(const Texture &equirect, int size = CUBEMAP_SIZE);
+
+    bool Empty(void) const {
+        return size == 0;
+    }
+
+    // Nearest texel in direction dir, which need not be normalized
+    inline Uint32 Fetch(const vec3 &dir) const {
+        float ax = fabsf(dir.x);
+        float ay = fabsf(dir.y);
+        float az = fabsf(dir.z);
+        int face;
+        float sc, tc, ma;
+        if (ax >= ay && ax >= az) {
+            face = dir.x >= 0 ? CUBE_POSITIVE_X : CUBE_NEGATIVE_X;
+            sc = dir.x >= 0 ? -dir.z : dir.z;
+            tc = -dir.y;
+            ma = ax;
+        }
+        else if (ay >= az) {
+            face = dir.y >= 0 ? CUBE_POSITIVE_Y : CUBE_NEGATIVE_Y;
+            sc = dir.x;
+            tc = dir.y >= 0 ? dir.z : -dir.z;
+            ma = ay;
+        }
+        else {
+            face = dir.z >= 0 ? CUBE_POSITIVE_Z : CUBE_NEGATIVE_Z;
+            sc = dir.z >= 0 ? dir.x : -dir.x;
+            tc = -dir.y;
+            ma = az;
+        }
+        if (!(ma > 0)) {
+            // Zero vector, any texel will do
+            return faces[face].Fetch(0, 0);
+        }
+
+        // Map sc / ma and tc / ma from [-1, 1] to texels
+        float scale = 0.5f * size / ma;
+        float half = 0.5f * size;
+        int x = (int)(sc * scale + half);
+        int y = (int)(tc * scale + half);
+        x = x < 0 ? 0 : (x >= size ? size - 1 : x);
+        y = y < 0 ? 0 : (y >= size ? size - 1 : y);
+        return faces[face].Fetch(x, y);
+    }
+};
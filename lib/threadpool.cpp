@@ -0,0 +1,85 @@
+#include "threadpool.h"
+#include <algorithm>
+
+//=============================================
+// ThreadPool
+//=============================================
+
+ThreadPool::ThreadPool(int num_threads) {
+    this->num_threads = std::max(num_threads, 1);
+    this->task_fn = NULL;
+    this->task_ctx = NULL;
+    this->task_count = 0;
+    this->next_task = 0;
+    this->busy = 0;
+    this->batch = 0;
+    this->quit = false;
+
+    for (int thread = 1; thread < this->num_threads; thread++) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, thread);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard< std::mutex > lock(mutex);
+        quit = true;
+    }
+    start.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+void ThreadPool::RunTasks(int count, void (*fn)(void*, int, int), void *ctx) {
+    if (workers.empty()) {
+        for (int i = 0; i < count; i++) {
+            fn(ctx, i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard< std::mutex > lock(mutex);
+        task_fn = fn;
+        task_ctx = ctx;
+        task_count = count;
+        next_task = 0;
+        busy = workers.size();
+        batch++;
+    }
+    start.notify_all();
+
+    Work(0);
+
+    std::unique_lock< std::mutex > lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+}
+
+void ThreadPool::WorkerLoop(int thread) {
+    unsigned int seen = 0;
+    while (true) {
+        {
+            std::unique_lock< std::mutex > lock(mutex);
+            start.wait(lock, [this, seen] { return quit || batch != seen; });
+            if (quit) {
+                return;
+            }
+            seen = batch;
+        }
+
+        Work(thread);
+
+        std::lock_guard< std::mutex > lock(mutex);
+        if (--busy == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::Work(int thread) {
+    int i;
+    while ((i = next_task++) < task_count) {
+        task_fn(task_ctx, i, thread);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//================================
+// ThreadPool
+//================================
+
+// Persistent worker threads that run a batch of tasks at a time.
+// The calling thread works on the batch too and Run returns once every
+// task has finished.
+class ThreadPool {
+public:
+    int num_threads;                        // workers plus the calling thread
+    std::vector< std::thread > workers;
+    std::mutex mutex;
+    std::condition_variable start;          // signalled when a batch is ready
+    std::condition_variable done;           // signalled when the last worker finishes
+    void (*task_fn)(void *task_ctx, int task, int thread);
+    void *task_ctx;
+    int task_count;
+    std::atomic< int > next_task;           // next task to hand out
+    int busy;                               // workers still on the current batch
+    unsigned int batch;                     // incremented for every batch
+    bool quit;
+
+public:
+    ThreadPool(int num_threads);
+
+    ~ThreadPool();
+
+    // Call task(i, thread) for i in [0, count), thread in [0, num_threads)
+    template <typename Task>
+    void Run(int count, Task &task) {
+        RunTasks(count, [](void *ctx, int i, int thread) { (*(Task*)ctx)(i, thread); }, &task);
+    }
+
+    void RunTasks(int count, void (*fn)(void*, int, int), void *ctx);
+
+private:
+    void WorkerLoop(int thread);
+
+    void Work(int thread);
+};
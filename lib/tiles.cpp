@@ -0,0 +1,75 @@
+#include "tiles.h"
+#include <algorithm>
+
+//=============================================
+// TileBins
+//=============================================
+
+TileBins::TileBins(int width, int height) {
+    this->width = 0;
+    this->height = 0;
+    Resize(width, height);
+}
+
+void TileBins::Resize(int width, int height) {
+    if (width == this->width && height == this->height) {
+        return;
+    }
+    this->width = width;
+    this->height = height;
+    tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    offsets.assign(NumTiles() + 1, 0);
+}
+
+ClipRect TileBins::TileRect(int tile) {
+    int tx = tile % tiles_x;
+    int ty = tile / tiles_x;
+    return ClipRect(tx * TILE_SIZE, ty * TILE_SIZE,
+                    std::min((tx + 1) * TILE_SIZE, width) - 1,
+                    std::min((ty + 1) * TILE_SIZE, height) - 1);
+}
+
+void TileBins::Bin(const std::vector< int > &face_ids, const std::vector< ClipRect > &bounds) {
+    // Count faces per tile
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (size_t k = 0; k < face_ids.size(); k++) {
+        const ClipRect &b = bounds[k];
+        if (b.x0 > b.x1 || b.y0 > b.y1) {
+            continue;
+        }
+        for (int ty = b.y0 / TILE_SIZE; ty <= b.y1 / TILE_SIZE; ty++) {
+            for (int tx = b.x0 / TILE_SIZE; tx <= b.x1 / TILE_SIZE; tx++) {
+                offsets[ty * tiles_x + tx + 1]++;
+            }
+        }
+    }
+
+    // Prefix sum into offsets
+    for (int tile = 0; tile < NumTiles(); tile++) {
+        offsets[tile + 1] += offsets[tile];
+    }
+
+    // Scatter faces in draw order
+    fill.assign(offsets.begin(), offsets.end() - 1);
+    faces.resize(offsets[NumTiles()]);
+    for (size_t k = 0; k < face_ids.size(); k++) {
+        const ClipRect &b = bounds[k];
+        if (b.x0 > b.x1 || b.y0 > b.y1) {
+            continue;
+        }
+        for (int ty = b.y0 / TILE_SIZE; ty <= b.y1 / TILE_SIZE; ty++) {
+            for (int tx = b.x0 / TILE_SIZE; tx <= b.x1 / TILE_SIZE; tx++) {
+                faces[fill[ty * tiles_x + tx]++] = face_ids[k];
+            }
+        }
+    }
+}
+
+//=============================================
+// TileRenderer
+//=============================================
+
+TileRenderer::TileRenderer(int num_threads) : pool(num_threads) {
+    contexts.resize(pool.num_threads);
+}
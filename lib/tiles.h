@@ -0,0 +1,64 @@
+#pragma once
+#include "constants.h"
+#include "rasterizer.h"
+#include "threadpool.h"
+#include <vector>
+
+//================================
+// TileBins
+//================================
+
+#define TILE_SIZE 64
+static_assert(TILE_SIZE % DEPTH_TILE == 0, "depth tiles must not straddle screen tiles");
+
+// Faces sorted into the screen tiles their bounding boxes overlap.
+// Faces keep their draw order within each tile.
+class TileBins {
+public:
+    int width;                      // screen size in pixels
+    int height;
+    int tiles_x;
+    int tiles_y;
+    std::vector< int > offsets;     // CSR offsets into faces, size tiles + 1
+    std::vector< int > faces;       // face indices of every tile
+    std::vector< int > fill;        // scratch for Bin
+
+public:
+    TileBins(int width = SCREEN_WIDTH, int height = SCREEN_HEIGHT);
+
+    ~TileBins() {}
+
+    // Cover a width x height screen, a no-op if the size is unchanged
+    void Resize(int width, int height);
+
+    int NumTiles(void) {
+        return tiles_x * tiles_y;
+    }
+
+    // Pixels covered by tile, clamped to the screen
+    ClipRect TileRect(int tile);
+
+    // Bin face_ids[k] by bounds[k], faces with empty bounds are dropped
+    void Bin(const std::vector< int > &face_ids, const std::vector< ClipRect > &bounds);
+};
+
+//================================
+// TileRenderer
+//================================
+
+// Sort-middle rendering: faces are binned into tiles and the tiles are
+// rasterized in parallel. Each tile owns its pixels in the color and depth
+// buffers, so threads never write the same pixel.
+class TileRenderer {
+public:
+    ThreadPool pool;
+    TileBins bins;
+    std::vector< RasterContext > contexts;  // one per thread
+    std::vector< ClipRect > bounds;         // screen bounds of each face being binned
+    std::vector< Uint64 > counts;           // per thread tallies of the current batch
+
+public:
+    TileRenderer(int num_threads);
+
+    ~TileRenderer() {}
+};
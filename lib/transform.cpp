@@ -0,0 +1,231 @@
+#include "transform.h"
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 arrays are read as packed floats");
+static_assert(sizeof(vec4) == 4 * sizeof(float), "vec4 arrays are written as packed floats");
+
+//=============================================
+// Scalar
+//=============================================
+
+// OUT floats are written per vertex: 3 (xyz) or 4 (xyzw). w is the fourth
+// input coordinate, 1 for points and 0 for vectors.
+template <int OUT>
+static void TransformScalar(const float *m, const vec3 *in, float *out, size_t count, float w) {
+    for (size_t i = 0; i < count; i++) {
+        float x = in[i].x;
+        float y = in[i].y;
+        float z = in[i].z;
+        float *o = out + OUT * i;
+        for (int r = 0; r < OUT; r++) {
+            o[r] = m[r * 4] * x + m[r * 4 + 1] * y + m[r * 4 + 2] * z + m[r * 4 + 3] * w;
+        }
+    }
+}
+
+#ifdef TRANSFORM_X86
+
+// Shuffle with lanes listed in memory order
+#define SHUFFLE(i0, i1, i2, i3) _MM_SHUFFLE(i3, i2, i1, i0)
+
+//=============================================
+// SSE2
+//=============================================
+
+// Split 4 packed vec3 (x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3) into x, y and z
+__attribute__((target("sse2")))
+static inline void Deinterleave4(const float *p, __m128 &x, __m128 &y, __m128 &z) {
+    __m128 a = _mm_loadu_ps(p);
+    __m128 b = _mm_loadu_ps(p + 4);
+    __m128 c = _mm_loadu_ps(p + 8);
+    x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, SHUFFLE(0, 0, 3, 3)), _mm_shuffle_ps(b, c, SHUFFLE(2, 2, 1, 1)), SHUFFLE(0, 2, 0, 2));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, SHUFFLE(1, 1, 0, 0)), _mm_shuffle_ps(b, c, SHUFFLE(3, 3, 2, 2)), SHUFFLE(0, 2, 0, 2));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(c, c, SHUFFLE(0, 0, 3, 3)), SHUFFLE(0, 2, 0, 2));
+}
+
+// Store 4 vertices given as rows o[0..OUT), o is overwritten
+template <int OUT>
+__attribute__((target("sse2")))
+static inline void Store4(float *out, __m128 *o) {
+    if (OUT == 3) {
+        o[3] = _mm_setzero_ps();
+    }
+    _MM_TRANSPOSE4_PS(o[0], o[1], o[2], o[3]);
+    if (OUT == 4) {
+        for (int k = 0; k < 4; k++) {
+            _mm_storeu_ps(out + 4 * k, o[k]);
+        }
+    }
+    else {
+        // Each store spills one float into the next vertex, which the next
+        // store overwrites. The last vertex is copied exactly.
+        for (int k = 0; k < 3; k++) {
+            _mm_storeu_ps(out + 3 * k, o[k]);
+        }
+        float last[4];
+        _mm_storeu_ps(last, o[3]);
+        memcpy(out + 9, last, 3 * sizeof(float));
+    }
+}
+
+template <int OUT>
+__attribute__((target("sse2")))
+static void TransformSSE2(const float *m, const vec3 *in, float *out, size_t count, float w) {
+    __m128 mm[4][3];
+    __m128 mw[4];
+    for (int r = 0; r < OUT; r++) {
+        for (int c = 0; c < 3; c++) {
+            mm[r][c] = _mm_set1_ps(m[r * 4 + c]);
+        }
+        mw[r] = _mm_set1_ps(m[r * 4 + 3] * w);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        Deinterleave4(&in[i].x, x, y, z);
+        __m128 o[4];
+        for (int r = 0; r < OUT; r++) {
+            __m128 sum = _mm_add_ps(_mm_mul_ps(mm[r][0], x), _mm_mul_ps(mm[r][1], y));
+            sum = _mm_add_ps(sum, _mm_mul_ps(mm[r][2], z));
+            o[r] = _mm_add_ps(sum, mw[r]);
+        }
+        Store4<OUT>(out + OUT * i, o);
+    }
+    TransformScalar<OUT>(m, in + i, out + OUT * i, count - i, w);
+}
+
+//=============================================
+// AVX2
+//=============================================
+
+// Kept to separate multiplies and adds (no FMA) so rounding matches the scalar path
+template <int OUT>
+__attribute__((target("avx2")))
+static void TransformAVX2(const float *m, const vec3 *in, float *out, size_t count, float w) {
+    __m256 mm[4][3];
+    __m256 mw[4];
+    for (int r = 0; r < OUT; r++) {
+        for (int c = 0; c < 3; c++) {
+            mm[r][c] = _mm256_set1_ps(m[r * 4 + c]);
+        }
+        mw[r] = _mm256_set1_ps(m[r * 4 + 3] * w);
+    }
+
+    // Offsets of x in 8 packed vec3
+    const __m256i offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const float *p = &in[i].x;
+        __m256 x = _mm256_i32gather_ps(p, offsets, 4);
+        __m256 y = _mm256_i32gather_ps(p + 1, offsets, 4);
+        __m256 z = _mm256_i32gather_ps(p + 2, offsets, 4);
+        __m256 o[4];
+        for (int r = 0; r < OUT; r++) {
+            __m256 sum = _mm256_add_ps(_mm256_mul_ps(mm[r][0], x), _mm256_mul_ps(mm[r][1], y));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(mm[r][2], z));
+            o[r] = _mm256_add_ps(sum, mw[r]);
+        }
+
+        // Transpose and store each half as 4 vertices
+        __m128 lo[4], hi[4];
+        for (int r = 0; r < OUT; r++) {
+            lo[r] = _mm256_castps256_ps128(o[r]);
+            hi[r] = _mm256_extractf128_ps(o[r], 1);
+        }
+        Store4<OUT>(out + OUT * i, lo);
+        Store4<OUT>(out + OUT * (i + 4), hi);
+    }
+    TransformScalar<OUT>(m, in + i, out + OUT * i, count - i, w);
+}
+
+#endif
+
+//=============================================
+// Dispatch
+//=============================================
+
+typedef void (*TransformKernel)(const float *m, const vec3 *in, float *out, size_t count, float w);
+
+static TransformPath BestTransformPath(void) {
+    #ifdef TRANSFORM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return TRANSFORM_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return TRANSFORM_SSE2;
+    }
+    #endif
+    return TRANSFORM_SCALAR;
+}
+
+static TransformPath g_transform_path = BestTransformPath();
+
+TransformPath GetTransformPath(void) {
+    return g_transform_path;
+}
+
+bool TransformPathSupported(TransformPath path) {
+    return path <= BestTransformPath();
+}
+
+bool SetTransformPath(TransformPath path) {
+    if (!TransformPathSupported(path)) {
+        return false;
+    }
+    g_transform_path = path;
+    return true;
+}
+
+const char* TransformPathName(TransformPath path) {
+    switch (path) {
+        case TRANSFORM_SCALAR:
+            return "scalar";
+        case TRANSFORM_SSE2:
+            return "sse2";
+        case TRANSFORM_AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+template <int OUT>
+static TransformKernel Kernel(void) {
+    switch (g_transform_path) {
+        #ifdef TRANSFORM_X86
+        case TRANSFORM_AVX2:
+            return TransformAVX2<OUT>;
+        case TRANSFORM_SSE2:
+            return TransformSSE2<OUT>;
+        #endif
+        default:
+            return TransformScalar<OUT>;
+    }
+}
+
+void TransformPoints(const mat4 &m, const vec3 *in, vec4 *out, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    Kernel<4>()(m.mat, in, &out->x, count, 1.0f);
+}
+
+void TransformPoints(const mat4 &m, const vec3 *in, vec3 *out, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    Kernel<3>()(m.mat, in, &out->x, count, 1.0f);
+}
+
+void TransformVectors(const mat4 &m, const vec3 *in, vec3 *out, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    Kernel<3>()(m.mat, in, &out->x, count, 0.0f);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+#include <stddef.h>
+
+//================================
+// Batch transforms
+//================================
+
+// Transform arrays of vec3 by a mat4 several vertices at a time. The code
+// path is chosen on first use from what the CPU supports. Every path
+// computes each output as m[r*4]*x + m[r*4+1]*y + m[r*4+2]*z + m[r*4+3]*w,
+// in that order, so results are bit-identical to mat4 * vec4.
+
+enum TransformPath {
+    TRANSFORM_SCALAR,
+    TRANSFORM_SSE2,     // 4 vertices per iteration
+    TRANSFORM_AVX2,     // 8 vertices per iteration
+};
+
+// Path in use, the best one the CPU supports unless overridden
+TransformPath GetTransformPath(void);
+
+// Force a path, for benchmarks and testing. Returns false (and keeps the
+// current path) if the CPU doesn't support it.
+bool SetTransformPath(TransformPath path);
+
+bool TransformPathSupported(TransformPath path);
+
+const char* TransformPathName(TransformPath path);
+
+// out[i] = m * vec4(in[i], 1)
+void TransformPoints(const mat4 &m, const vec3 *in, vec4 *out, size_t count);
+
+// out[i] = xyz of m * vec4(in[i], 1), for matrices with no projection
+void TransformPoints(const mat4 &m, const vec3 *in, vec3 *out, size_t count);
+
+// out[i] = xyz of m * vec4(in[i], 0)
+void TransformVectors(const mat4 &m, const vec3 *in, vec3 *out, size_t count);
@@ -35,10 +35,16 @@ void SetPixel(SDL_Surface *surface, int x, int y, Uint8 r, Uint8 g, Uint8 b, Uin
 }
 
 void GetPixel(SDL_Surface *surface, int x, int y, Uint8 *r, Uint8 *g, Uint8 *b, Uint8 *a) {
-    SDL_LockSurface(surface);
+    // Only lock surfaces that need it, locking updates the surface and is not thread safe
+    bool lock = SDL_MUSTLOCK(surface);
+    if (lock) {
+        SDL_LockSurface(surface);
+    }
     Uint32 *buffer = (Uint32*) surface->pixels;
     int offset = y * surface->w + x;
     Uint32 pixel = buffer[offset];
     SDL_GetRGBA(pixel, surface->format, r, g, b, a); 
-    SDL_UnlockSurface(surface);
+    if (lock) {
+        SDL_UnlockSurface(surface);
+    }
 }
\ No newline at end of file
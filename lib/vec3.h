@@ -1,46 +1,112 @@
 #pragma once
+#include <assert.h>
+#include <cmath>
+#include <type_traits>
 
+// Header only so the per pixel math inlines into the span loops. Asserts
+// compile out with -DNDEBUG (make release).
 class vec3 {
 public:
 	float x, y, z;
 
 public:
-	vec3();
-	vec3(float x, float y, float z);
+	constexpr vec3() : x(0), y(0), z(0) {}
+	constexpr vec3(float x, float y, float z) : x(x), y(y), z(z) {}
 
-	vec3& set(float x, float y, float z);
+	constexpr vec3& set(float x, float y, float z) {
+		this->x = x;
+		this->y = y;
+		this->z = z;
+		return *this;
+	}
 
-	vec3& zero(void);
+	constexpr vec3& zero(void) {
+		x = y = z = 0;
+		return *this;
+	}
 
-	vec3			operator- (void) const;
-	vec3			operator+ (void) const;
+	constexpr vec3 operator- (void) const { return vec3(-x, -y, -z); }
+	constexpr vec3 operator+ (void) const { return vec3(x, y, z); }
 
-	vec3			operator+ (const vec3& v) const;
-	vec3			operator- (const vec3& v) const;
-	vec3			operator* (float scalar) const;
-	vec3			operator/ (float scalar) const;
+	constexpr vec3 operator+ (const vec3& v) const { return vec3(x + v.x, y + v.y, z + v.z); }
+	constexpr vec3 operator- (const vec3& v) const { return vec3(x - v.x, y - v.y, z - v.z); }
+	constexpr vec3 operator* (float scalar) const { return vec3(x * scalar, y * scalar, z * scalar); }
+	constexpr vec3 operator/ (float scalar) const {
+		float inv = 1.0 / scalar;
+		return vec3(x * inv, y * inv, z * inv);
+	}
 
-	vec3& operator= (const vec3& v);
-	vec3& operator+=(const vec3& v);
-	vec3& operator-=(const vec3& v);
-	vec3& operator*=(float scalar);
-	vec3& operator/=(float scalar);
+	constexpr vec3& operator+=(const vec3& v) {
+		x += v.x;
+		y += v.y;
+		z += v.z;
+		return *this;
+	}
 
-	float& operator[](int index);
-	const float& operator[](int index) const;
+	constexpr vec3& operator-=(const vec3& v) {
+		x -= v.x;
+		y -= v.y;
+		z -= v.z;
+		return *this;
+	}
 
-	float			dot(const vec3& v) const;
-	vec3			cross(const vec3& v) const;
+	constexpr vec3& operator*=(float scalar) {
+		x *= scalar;
+		y *= scalar;
+		z *= scalar;
+		return *this;
+	}
 
-	float			magnitude(void) const;
-	vec3& normalize(void);
+	constexpr vec3& operator/=(float scalar) {
+		float inv = 1.0 / scalar;
+		x *= inv;
+		y *= inv;
+		z *= inv;
+		return *this;
+	}
 
-	float* ptr(void);
-	const float* ptr(void) const;
+	constexpr float& operator[](int index) {
+		assert(index >= 0 && index < 3);
+		return (&x)[index];
+	}
 
-public:
-    // Used when scalar * vec3
-    // Need friend to access private fields of vec3
-	friend vec3		operator*(float scalar, const vec3& v);
+	constexpr const float& operator[](int index) const {
+		assert(index >= 0 && index < 3);
+		return (&x)[index];
+	}
+
+	constexpr float dot(const vec3& v) const { return x * v.x + y * v.y + z * v.z; }
+
+	constexpr vec3 cross(const vec3& v) const {
+		return vec3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x);
+	}
+
+	float magnitude(void) const { return sqrtf(x * x + y * y + z * z); }
+
+	vec3& normalize(void) {
+		float mag = sqrtf(x * x + y * y + z * z);
+
+		if (mag < 1e-6f) {
+			x = y = z = 0;
+		}
+		else {
+			float inv = 1.0 / mag;
+
+			x *= inv;
+			y *= inv;
+			z *= inv;
+		}
+
+		return *this;
+	}
+
+	float* ptr(void) { return &x; }
+	const float* ptr(void) const { return &x; }
 };
 
+// Used when scalar * vec3
+constexpr vec3 operator*(float scalar, const vec3& v) {
+	return vec3(v.x * scalar, v.y * scalar, v.z * scalar);
+}
+
+static_assert(std::is_trivially_copyable< vec3 >::value, "vec3 is copied as raw floats");
@@ -1,50 +1,123 @@
 #pragma once
 #include "vec3.h"
 #include "mat4.h"
+#include <assert.h>
+#include <cmath>
+#include <type_traits>
 
+// Header only, like vec3
 class vec4 {
 public:
 	float x, y, z, w;
 
 public:
-	vec4();
-	vec4(const vec3 &vec, float w);
-	vec4(float x, float y, float z, float w);
+	constexpr vec4() : x(0), y(0), z(0), w(0) {}
+	constexpr vec4(const vec3 &vec, float w) : x(vec.x), y(vec.y), z(vec.z), w(w) {}
+	constexpr vec4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
 
-	vec4& set(float x, float y, float z, float w);
+	constexpr vec4& set(float x, float y, float z, float w) {
+		this->x = x;
+		this->y = y;
+		this->z = z;
+		this->w = w;
+		return *this;
+	}
 
-	vec4& zero(void);
+	constexpr vec4& zero(void) {
+		x = y = z = w = 0;
+		return *this;
+	}
 
-	vec4			operator- (void) const;
-	vec4			operator+ (void) const;
+	constexpr vec4 operator- (void) const { return vec4(-x, -y, -z, -w); }
+	constexpr vec4 operator+ (void) const { return vec4(x, y, z, w); }
 
-	vec4			operator+ (const vec4& v) const;
-	vec4			operator- (const vec4& v) const;
-	vec4			operator* (float scalar) const;
-	vec4			operator/ (float scalar) const;
+	constexpr vec4 operator+ (const vec4& v) const { return vec4(x + v.x, y + v.y, z + v.z, w + v.w); }
+	constexpr vec4 operator- (const vec4& v) const { return vec4(x - v.x, y - v.y, z - v.z, w - v.w); }
+	constexpr vec4 operator* (float scalar) const { return vec4(x * scalar, y * scalar, z * scalar, w * scalar); }
+	constexpr vec4 operator/ (float scalar) const {
+		float inv = 1.0 / scalar;
+		return vec4(x * inv, y * inv, z * inv, w * inv);
+	}
 
-	vec4& operator= (const vec4& v);
-	vec4& operator+=(const vec4& v);
-	vec4& operator-=(const vec4& v);
-	vec4& operator*=(float scalar);
-	vec4& operator/=(float scalar);
+	constexpr vec4& operator+=(const vec4& v) {
+		x += v.x;
+		y += v.y;
+		z += v.z;
+		w += v.w;
+		return *this;
+	}
 
-	float& operator[](int index);
-	const float& operator[](int index) const;
+	constexpr vec4& operator-=(const vec4& v) {
+		x -= v.x;
+		y -= v.y;
+		z -= v.z;
+		w -= v.w;
+		return *this;
+	}
 
-	float			dot(const vec4& v) const;
+	constexpr vec4& operator*=(float scalar) {
+		x *= scalar;
+		y *= scalar;
+		z *= scalar;
+		w *= scalar;
+		return *this;
+	}
 
-	float			magnitude(void) const;
-	vec4& normalize(void);
+	constexpr vec4& operator/=(float scalar) {
+		float inv = 1.0 / scalar;
+		x *= inv;
+		y *= inv;
+		z *= inv;
+		w *= inv;
+		return *this;
+	}
 
-	float* ptr(void);
-	const float* ptr(void) const;
+	constexpr float& operator[](int index) {
+		assert(index >= 0 && index < 4);
+		return (&x)[index];
+	}
 
-public:
-    // Used when order is `scalar * vec4`
-	// Or `mat4 * vec4`
-    // Need friend to access private fields of vec4
-	friend vec4		operator*(float scalar, const vec4& v);
-	friend vec4		operator*(const mat4& mat, const vec4& v);
+	constexpr const float& operator[](int index) const {
+		assert(index >= 0 && index < 4);
+		return (&x)[index];
+	}
+
+	constexpr float dot(const vec4& v) const { return x * v.x + y * v.y + z * v.z + w * v.w; }
+
+	float magnitude(void) const { return sqrtf(x * x + y * y + z * z + w * w); }
+
+	vec4& normalize(void) {
+		float mag = sqrtf(x * x + y * y + z * z + w * w);
+
+		if (mag < 1e-6f) {
+			x = y = z = w = 0;
+		}
+		else {
+			float inv = 1.0 / mag;
+
+			x *= inv;
+			y *= inv;
+			z *= inv;
+			w *= inv;
+		}
+
+		return *this;
+	}
+
+	float* ptr(void) { return &x; }
+	const float* ptr(void) const { return &x; }
 };
 
+// Used when order is `scalar * vec4`
+constexpr vec4 operator*(float scalar, const vec4& v) {
+	return vec4(v.x * scalar, v.y * scalar, v.z * scalar, v.w * scalar);
+}
+
+constexpr vec4 operator*(const mat4& mat, const vec4& v) {
+	return vec4(mat[0] * v.x + mat[1] * v.y + mat[2] * v.z + mat[3] * v.w,
+	            mat[4] * v.x + mat[5] * v.y + mat[6] * v.z + mat[7] * v.w,
+	            mat[8] * v.x + mat[9] * v.y + mat[10] * v.z + mat[11] * v.w,
+	            mat[12] * v.x + mat[13] * v.y + mat[14] * v.z + mat[15] * v.w);
+}
+
+static_assert(std::is_trivially_copyable< vec4 >::value, "vec4 is copied as raw floats");